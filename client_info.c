@@ -0,0 +1,631 @@
+/*
+ * file: client_info.c
+ * -------------------
+ * This file contains the functions that read everything NoteWM needs to know
+ * about a client window before managing it. All requests are sent at once
+ * through XCB and their replies are collected afterwards, so reading a new
+ * client costs a single round trip instead of one per query.
+ *
+ * Queries are started as soon as a top level window is created and kept in
+ * a small pending cache, so by the time it is mapped the replies are usually
+ * already waiting.
+ *
+ * Once a client is managed its properties are kept in its frame and only
+ * read again after a PropertyNotify has marked them stale.
+ *
+ * Author: Mason Armand
+ * Date Created: Jun 1, 2023
+ * Last Modified: Jun 8, 2023
+ */
+#include "notewm.h"
+
+/* layout of the WM_NORMAL_HINTS property, see ICCCM 4.1.2.3 */
+#define SIZE_HINTS_FLAGS 0
+#define SIZE_HINTS_WIDTH 3
+#define SIZE_HINTS_HEIGHT 4
+
+#define MAX_PENDING_CLIENTS 32
+#define MAX_PROTOCOLS 16
+#define MAX_CLASS_LENGTH 256
+
+xcb_get_property_cookie_t request_property(xcb_connection_t* conn, Window window, Atom property, Atom type, uint32_t length);
+void* property_value(xcb_connection_t* conn, xcb_get_property_cookie_t cookie, Atom* type, int* format, unsigned int* length, xcb_get_property_reply_t** reply);
+void copy_string(char* dest, const char* src, unsigned int length, unsigned int size);
+void copy_latin1(char* dest, const unsigned char* src, unsigned int length, unsigned int size);
+void copy_text_property(Display* display, xcb_connection_t* conn, xcb_get_property_cookie_t cookie, char* text, unsigned int size);
+unsigned int property_for_atom(Atom atom);
+void request_client_properties(xcb_connection_t* conn, NoteWM_ClientQuery* query, unsigned int properties);
+void collect_client_properties(Display* display, xcb_connection_t* conn, NoteWM_ClientQuery* query, NoteWM_ClientInfo* info, unsigned int properties);
+void discard_client_properties(xcb_connection_t* conn, NoteWM_ClientQuery* query, unsigned int properties);
+unsigned int collect_atoms(xcb_connection_t* conn, xcb_get_property_cookie_t cookie, Atom* atoms, unsigned int max);
+int find_pending_client(Window window);
+void remove_pending_client(int index);
+void forget_pending_client(Display* display, int index, bool destroyed);
+void pack_string(long* dest, const char* src, unsigned int size);
+void unpack_string(char* dest, const long* src, unsigned int size);
+
+/* windows that have been created but not mapped yet, oldest first */
+static NoteWM_ClientQuery pending_clients[MAX_PENDING_CLIENTS];
+static unsigned int num_pending_clients = 0;
+
+
+xcb_get_property_cookie_t request_property(xcb_connection_t* conn, Window window, Atom property, Atom type, uint32_t length)
+{
+        return xcb_get_property(conn, 0, window, property, type, 0, length);
+}
+
+
+/* waits for a property reply and returns its value, which stays valid until *reply is freed.
+ * returns NULL if the property is missing or the window is gone */
+void* property_value(xcb_connection_t* conn, xcb_get_property_cookie_t cookie, Atom* type, int* format, unsigned int* length, xcb_get_property_reply_t** reply)
+{
+        *reply = xcb_get_property_reply(conn, cookie, NULL);
+
+        if (!*reply || (*reply)->type == XCB_NONE || xcb_get_property_value_length(*reply) == 0)
+                return NULL;
+
+        if (type)
+                *type = (*reply)->type;
+        if (format)
+                *format = (*reply)->format;
+        if (length)
+                *length = (*reply)->value_len;
+
+        return xcb_get_property_value(*reply);
+}
+
+
+/* copies length bytes of a property value that is not NUL terminated */
+void copy_string(char* dest, const char* src, unsigned int length, unsigned int size)
+{
+        if (length > size - 1)
+                length = size - 1;
+        memcpy(dest, src, length);
+        dest[length] = '\0';
+}
+
+
+/* copies a Latin-1 string as UTF-8 */
+void copy_latin1(char* dest, const unsigned char* src, unsigned int length, unsigned int size)
+{
+        unsigned int i;
+        unsigned int n = 0;
+
+        for (i = 0; i < length && src[i]; i++) {
+                if (src[i] < 0x80) {
+                        if (n + 1 >= size)
+                                break;
+                        dest[n++] = src[i];
+                }
+                else {
+                        if (n + 2 >= size)
+                                break;
+                        dest[n++] = 0xc0 | (src[i] >> 6);
+                        dest[n++] = 0x80 | (src[i] & 0x3f);
+                }
+        }
+        dest[n] = '\0';
+}
+
+
+/* converts a text property to a UTF-8 string */
+void copy_text_property(Display* display, xcb_connection_t* conn, xcb_get_property_cookie_t cookie, char* text, unsigned int size)
+{
+        xcb_get_property_reply_t* reply;
+        XTextProperty name;
+        char** list = NULL;
+        unsigned int length;
+        Atom type;
+        int format;
+        int n;
+
+        name.value = property_value(conn, cookie, &type, &format, &length, &reply);
+        if (name.value && format == 8) {
+                name.encoding = type;
+                name.format = format;
+                name.nitems = length;
+
+                if (type == global_atoms[ATOM_UTF8_STRING]) {
+                        copy_string(text, (char*) name.value, length, size);
+                }
+                else if (type == XA_STRING) {
+                        copy_latin1(text, name.value, length, size);
+                }
+                else if (Xutf8TextPropertyToTextList(display, &name, &list, &n) >= Success && n > 0 && *list) {
+                        strncpy(text, *list, size - 1);
+                        text[size - 1] = '\0';
+                        XFreeStringList(list);
+                }
+        }
+        free(reply);
+}
+
+
+/* returns which NoteWM_ClientProperty an atom is stored in, or 0 if we do not care about it */
+unsigned int property_for_atom(Atom atom)
+{
+        if (atom == global_atoms[ATOM_NET_WM_WINDOW_TYPE])
+                return PROPERTY_WINDOW_TYPE;
+        if (atom == global_atoms[ATOM_NET_WM_STATE])
+                return PROPERTY_STATE;
+        if (atom == XA_WM_NORMAL_HINTS)
+                return PROPERTY_NORMAL_HINTS;
+        if (atom == global_atoms[ATOM_WM_PROTOCOLS])
+                return PROPERTY_PROTOCOLS;
+        if (atom == XA_WM_CLASS)
+                return PROPERTY_CLASS;
+        if (atom == global_atoms[ATOM_NET_WM_NAME] || atom == XA_WM_NAME)
+                return PROPERTY_NAME;
+        if (atom == global_atoms[ATOM_NET_WM_DESKTOP])
+                return PROPERTY_DESKTOP;
+        return 0;
+}
+
+
+void request_client_properties(xcb_connection_t* conn, NoteWM_ClientQuery* query, unsigned int properties)
+{
+        Window window = query->window;
+
+        if (properties & PROPERTY_WINDOW_TYPE)
+                query->window_type = request_property(conn, window, global_atoms[ATOM_NET_WM_WINDOW_TYPE], XA_ATOM, MAX_WINDOW_TYPES);
+        if (properties & PROPERTY_STATE)
+                query->state = request_property(conn, window, global_atoms[ATOM_NET_WM_STATE], XA_ATOM, MAX_WINDOW_STATES);
+        if (properties & PROPERTY_NORMAL_HINTS)
+                query->normal_hints = request_property(conn, window, XA_WM_NORMAL_HINTS, XA_WM_SIZE_HINTS, 18);
+        if (properties & PROPERTY_PROTOCOLS)
+                query->protocols = request_property(conn, window, global_atoms[ATOM_WM_PROTOCOLS], XA_ATOM, MAX_PROTOCOLS);
+        if (properties & PROPERTY_CLASS)
+                query->wm_class = request_property(conn, window, XA_WM_CLASS, XA_STRING, MAX_CLASS_LENGTH / 4);
+        if (properties & PROPERTY_NAME) {
+                query->net_wm_name = request_property(conn, window, global_atoms[ATOM_NET_WM_NAME], global_atoms[ATOM_UTF8_STRING], MAX_TITLE_LENGTH / 4);
+                query->wm_name = request_property(conn, window, XA_WM_NAME, AnyPropertyType, MAX_TITLE_LENGTH / 4);
+        }
+        if (properties & PROPERTY_DESKTOP)
+                query->desktop = request_property(conn, window, global_atoms[ATOM_NET_WM_DESKTOP], XA_CARDINAL, 1);
+}
+
+
+void discard_client_properties(xcb_connection_t* conn, NoteWM_ClientQuery* query, unsigned int properties)
+{
+        if (properties & PROPERTY_WINDOW_TYPE)
+                xcb_discard_reply(conn, query->window_type.sequence);
+        if (properties & PROPERTY_STATE)
+                xcb_discard_reply(conn, query->state.sequence);
+        if (properties & PROPERTY_NORMAL_HINTS)
+                xcb_discard_reply(conn, query->normal_hints.sequence);
+        if (properties & PROPERTY_PROTOCOLS)
+                xcb_discard_reply(conn, query->protocols.sequence);
+        if (properties & PROPERTY_CLASS)
+                xcb_discard_reply(conn, query->wm_class.sequence);
+        if (properties & PROPERTY_NAME) {
+                xcb_discard_reply(conn, query->net_wm_name.sequence);
+                xcb_discard_reply(conn, query->wm_name.sequence);
+        }
+        if (properties & PROPERTY_DESKTOP)
+                xcb_discard_reply(conn, query->desktop.sequence);
+}
+
+
+/* reads atom list replies such as _NET_WM_WINDOW_TYPE and _NET_WM_STATE */
+unsigned int collect_atoms(xcb_connection_t* conn, xcb_get_property_cookie_t cookie, Atom* atoms, unsigned int max)
+{
+        xcb_get_property_reply_t* reply;
+        unsigned int length;
+        unsigned int i = 0;
+        uint32_t* values = property_value(conn, cookie, NULL, NULL, &length, &reply);
+
+        for (i = 0; values && i < length && i < max; i++)
+                atoms[i] = values[i];
+        free(reply);
+        return values ? i : 0;
+}
+
+
+void collect_client_properties(Display* display, xcb_connection_t* conn, NoteWM_ClientQuery* query, NoteWM_ClientInfo* info, unsigned int properties)
+{
+        xcb_get_property_reply_t* reply;
+        uint32_t* values;
+        char* class_name;
+        unsigned int length;
+        unsigned int i;
+
+        if (properties & PROPERTY_WINDOW_TYPE)
+                info->num_window_types = collect_atoms(conn, query->window_type, info->window_types, MAX_WINDOW_TYPES);
+
+        if (properties & PROPERTY_STATE)
+                info->num_states = collect_atoms(conn, query->state, info->states, MAX_WINDOW_STATES);
+
+        if (properties & PROPERTY_NORMAL_HINTS) {
+                info->has_size_hint = false;
+                values = property_value(conn, query->normal_hints, NULL, NULL, &length, &reply);
+                if (values && length > SIZE_HINTS_HEIGHT) {
+                        info->has_size_hint = (values[SIZE_HINTS_FLAGS] & PSize) && values[SIZE_HINTS_WIDTH] != 0;
+                        info->hint_width = values[SIZE_HINTS_WIDTH];
+                        info->hint_height = values[SIZE_HINTS_HEIGHT];
+                }
+                free(reply);
+        }
+
+        if (properties & PROPERTY_PROTOCOLS) {
+                info->supports_delete_window = false;
+                values = property_value(conn, query->protocols, NULL, NULL, &length, &reply);
+                for (i = 0; values && i < length; i++) {
+                        if (values[i] == global_atoms[ATOM_WM_DELETE_WINDOW])
+                                info->supports_delete_window = true;
+                }
+                free(reply);
+        }
+
+        if (properties & PROPERTY_CLASS) {
+                info->res_name[0] = '\0';
+                info->res_class[0] = '\0';
+                /* WM_CLASS is the instance name and the class name, each NUL terminated */
+                class_name = property_value(conn, query->wm_class, NULL, NULL, &length, &reply);
+                if (class_name) {
+                        unsigned int instance_length = strnlen(class_name, length);
+
+                        copy_string(info->res_name, class_name, instance_length, sizeof(info->res_name));
+                        if (instance_length + 1 < length) {
+                                class_name += instance_length + 1;
+                                length -= instance_length + 1;
+                                copy_string(info->res_class, class_name, strnlen(class_name, length), sizeof(info->res_class));
+                        }
+                }
+                free(reply);
+        }
+
+        if (properties & PROPERTY_NAME) {
+                info->name[0] = '\0';
+                /* _NET_WM_NAME wins over WM_NAME, both replies are always consumed */
+                copy_text_property(display, conn, query->net_wm_name, info->name, sizeof(info->name));
+                if (info->name[0] == '\0')
+                        copy_text_property(display, conn, query->wm_name, info->name, sizeof(info->name));
+                else
+                        xcb_discard_reply(conn, query->wm_name.sequence);
+        }
+
+        if (properties & PROPERTY_DESKTOP) {
+                info->desktop = -1;
+                values = property_value(conn, query->desktop, NULL, NULL, &length, &reply);
+                if (values && length >= 1)
+                        info->desktop = values[0];
+                free(reply);
+        }
+}
+
+
+void query_client_info(Display* display, Window window, NoteWM_ClientQuery* query)
+{
+        xcb_connection_t* conn = XGetXCBConnection(display);
+
+        query->window = window;
+        query->attributes = xcb_get_window_attributes(conn, window);
+        query->geometry = xcb_get_geometry(conn, window);
+        query->tree = xcb_query_tree(conn, window);
+        request_client_properties(conn, query, PROPERTY_ALL);
+}
+
+
+/* sends a new request for one part of an outstanding query after the client
+ * changed it, dropping the reply to the old one. None stands for the geometry */
+void refresh_client_query(Display* display, NoteWM_ClientQuery* query, Atom atom)
+{
+        xcb_connection_t* conn = XGetXCBConnection(display);
+        unsigned int property = property_for_atom(atom);
+
+        if (atom == None) {
+                xcb_discard_reply(conn, query->geometry.sequence);
+                query->geometry = xcb_get_geometry(conn, query->window);
+        }
+        else if (property) {
+                discard_client_properties(conn, query, property);
+                request_client_properties(conn, query, property);
+        }
+}
+
+
+/* fills info from the replies to a query_client_info() call.
+ * returns false if the window no longer exists */
+bool collect_client_info(Display* display, NoteWM_ClientQuery* query, NoteWM_ClientInfo* info)
+{
+        xcb_connection_t* conn = XGetXCBConnection(display);
+        xcb_get_window_attributes_reply_t* attributes;
+        xcb_get_geometry_reply_t* geometry;
+        xcb_query_tree_reply_t* tree;
+
+        memset(info, 0, sizeof(*info));
+        info->window = query->window;
+
+        attributes = xcb_get_window_attributes_reply(conn, query->attributes, NULL);
+        geometry = xcb_get_geometry_reply(conn, query->geometry, NULL);
+        tree = xcb_query_tree_reply(conn, query->tree, NULL);
+
+        info->valid = (attributes && geometry && tree);
+        if (attributes) {
+                info->override_redirect = attributes->override_redirect;
+                info->map_state = attributes->map_state;
+                free(attributes);
+        }
+        if (geometry) {
+                info->x = geometry->x;
+                info->y = geometry->y;
+                info->width = geometry->width;
+                info->height = geometry->height;
+                free(geometry);
+        }
+        if (tree) {
+                info->parent = tree->parent;
+                free(tree);
+        }
+
+        collect_client_properties(display, conn, query, info, PROPERTY_ALL);
+
+        return info->valid;
+}
+
+
+/* throws away the replies of a query that is no longer needed */
+void discard_client_query(Display* display, NoteWM_ClientQuery* query)
+{
+        xcb_connection_t* conn = XGetXCBConnection(display);
+
+        xcb_discard_reply(conn, query->attributes.sequence);
+        xcb_discard_reply(conn, query->geometry.sequence);
+        xcb_discard_reply(conn, query->tree.sequence);
+        discard_client_properties(conn, query, PROPERTY_ALL);
+}
+
+
+/* ---------- Per Frame Property Cache ---------- */
+/* marks the cached copy of a client property as out of date */
+void invalidate_frame_property(NoteWM_Frame* frame, Atom atom)
+{
+        frame->stale_properties |= property_for_atom(atom);
+}
+
+
+/* re-reads every stale property of the frame's client in one round trip */
+void refresh_frame_info(Display* display, NoteWM_Frame* frame)
+{
+        xcb_connection_t* conn;
+        NoteWM_ClientQuery query;
+        unsigned int stale = frame->stale_properties;
+
+        if (!stale)
+                return;
+
+        conn = XGetXCBConnection(display);
+        query.window = frame->child_window;
+        request_client_properties(conn, &query, stale);
+        collect_client_properties(display, conn, &query, &frame->info, stale);
+        frame->stale_properties = 0;
+}
+
+
+bool client_has_state(NoteWM_ClientInfo* info, Atom state)
+{
+        unsigned int i;
+        for (i = 0; i < info->num_states; i++) {
+                if (info->states[i] == state)
+                        return true;
+        }
+        return false;
+}
+
+
+/* returns the window type of the client, or None if it has none NoteWM knows about */
+Atom client_window_type(NoteWM_ClientInfo* info)
+{
+        static const int known_types[] = {
+                ATOM_NET_WM_WINDOW_TYPE_NORMAL,
+                ATOM_NET_WM_WINDOW_TYPE_DIALOG,
+                ATOM_NET_WM_WINDOW_TYPE_DOCK,
+                ATOM_NET_WM_WINDOW_TYPE_TOOLBAR,
+                ATOM_NET_WM_WINDOW_TYPE_UTILITY,
+                ATOM_NET_WM_WINDOW_TYPE_MENU,
+                ATOM_NET_WM_WINDOW_TYPE_DROPDOWN_MENU,
+                ATOM_NET_WM_WINDOW_TYPE_POPUP_MENU,
+                ATOM_NET_WM_WINDOW_TYPE_TOOLTIP,
+                ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION,
+                ATOM_NET_WM_WINDOW_TYPE_COMBO,
+                ATOM_NET_WM_WINDOW_TYPE_DND,
+                ATOM_NET_WM_WINDOW_TYPE_DESKTOP
+        };
+        unsigned int i;
+        unsigned int j;
+
+        /* _NET_WM_WINDOW_TYPE is in order of preference, so the first type
+         * we know about is the one that counts */
+        for (i = 0; i < info->num_window_types; i++) {
+                for (j = 0; j < sizeof(known_types) / sizeof(known_types[0]); j++) {
+                        if (info->window_types[i] == global_atoms[known_types[j]])
+                                return info->window_types[i];
+                }
+        }
+        return None;
+}
+
+
+/* decides from _NET_WM_WINDOW_TYPE whether a window gets a frame. the first
+ * type NoteWM knows about decides, and windows without one are framed */
+bool is_framed_window_type(NoteWM_ClientInfo* info)
+{
+        Atom type = client_window_type(info);
+
+        return type == None
+                || type == global_atoms[ATOM_NET_WM_WINDOW_TYPE_NORMAL]
+                || type == global_atoms[ATOM_NET_WM_WINDOW_TYPE_DIALOG];
+}
+
+
+/* ---------- Restart Functions ---------- */
+/* packs a NUL terminated string into size / 4 elements, four bytes to an
+ * element, because only the low 32 bits of each element reach the server */
+void pack_string(long* dest, const char* src, unsigned int size)
+{
+        unsigned int i;
+
+        for (i = 0; i < size; i += 4) {
+                dest[i / 4] = (long) ((unsigned long) (unsigned char) src[i]
+                        | ((unsigned long) (unsigned char) src[i + 1] << 8)
+                        | ((unsigned long) (unsigned char) src[i + 2] << 16)
+                        | ((unsigned long) (unsigned char) src[i + 3] << 24));
+        }
+}
+
+
+void unpack_string(char* dest, const long* src, unsigned int size)
+{
+        unsigned int i;
+
+        for (i = 0; i < size; i++)
+                dest[i] = (char) ((unsigned long) src[i / 4] >> ((i % 4) * 8));
+        dest[size - 1] = '\0';
+}
+
+
+/* stores the cached properties of a client in record, which has INFO_SIZE
+ * elements, so a restarted NoteWM does not have to ask for them again */
+void save_client_info(NoteWM_ClientInfo* info, long* record)
+{
+        char text[MAX_TITLE_LENGTH];
+        unsigned int i;
+
+        memset(record, 0, INFO_SIZE * sizeof(long));
+        record[INFO_NUM_WINDOW_TYPES] = info->num_window_types;
+        for (i = 0; i < info->num_window_types; i++)
+                record[INFO_WINDOW_TYPES + i] = info->window_types[i];
+        record[INFO_NUM_STATES] = info->num_states;
+        for (i = 0; i < info->num_states; i++)
+                record[INFO_STATES + i] = info->states[i];
+
+        record[INFO_FLAGS] = (info->has_size_hint ? INFO_HAS_SIZE_HINT : 0)
+                | (info->supports_delete_window ? INFO_SUPPORTS_DELETE : 0);
+        record[INFO_HINT_WIDTH] = info->hint_width;
+        record[INFO_HINT_HEIGHT] = info->hint_height;
+        record[INFO_DESKTOP] = info->desktop;
+
+        /* the bytes after the terminator are not necessarily initialised */
+        memset(text, 0, sizeof(text));
+        strncpy(text, info->res_name, sizeof(info->res_name) - 1);
+        pack_string(&record[INFO_RES_NAME], text, sizeof(info->res_name));
+        memset(text, 0, sizeof(text));
+        strncpy(text, info->res_class, sizeof(info->res_class) - 1);
+        pack_string(&record[INFO_RES_CLASS], text, sizeof(info->res_class));
+        memset(text, 0, sizeof(text));
+        strncpy(text, info->name, sizeof(info->name) - 1);
+        pack_string(&record[INFO_NAME], text, sizeof(info->name));
+}
+
+
+/* fills in the cached properties of info from a record written by
+ * save_client_info(). the rest of info is left alone */
+void restore_client_info(const long* record, NoteWM_ClientInfo* info)
+{
+        unsigned int i;
+
+        info->num_window_types = record[INFO_NUM_WINDOW_TYPES];
+        if (info->num_window_types > MAX_WINDOW_TYPES)
+                info->num_window_types = MAX_WINDOW_TYPES;
+        for (i = 0; i < info->num_window_types; i++)
+                info->window_types[i] = record[INFO_WINDOW_TYPES + i];
+
+        info->num_states = record[INFO_NUM_STATES];
+        if (info->num_states > MAX_WINDOW_STATES)
+                info->num_states = MAX_WINDOW_STATES;
+        for (i = 0; i < info->num_states; i++)
+                info->states[i] = record[INFO_STATES + i];
+
+        info->has_size_hint = (record[INFO_FLAGS] & INFO_HAS_SIZE_HINT) != 0;
+        info->supports_delete_window = (record[INFO_FLAGS] & INFO_SUPPORTS_DELETE) != 0;
+        info->hint_width = record[INFO_HINT_WIDTH];
+        info->hint_height = record[INFO_HINT_HEIGHT];
+        info->desktop = record[INFO_DESKTOP];
+
+        unpack_string(info->res_name, &record[INFO_RES_NAME], sizeof(info->res_name));
+        unpack_string(info->res_class, &record[INFO_RES_CLASS], sizeof(info->res_class));
+        unpack_string(info->name, &record[INFO_NAME], sizeof(info->name));
+}
+
+
+/* ---------- Pending Client Cache ---------- */
+int find_pending_client(Window window)
+{
+        unsigned int i;
+        for (i = 0; i < num_pending_clients; i++) {
+                if (pending_clients[i].window == window)
+                        return i;
+        }
+        return -1;
+}
+
+
+void remove_pending_client(int index)
+{
+        num_pending_clients--;
+        memmove(&pending_clients[index], &pending_clients[index + 1], (num_pending_clients - index) * sizeof(NoteWM_ClientQuery));
+}
+
+
+/* drops a prefetched query for a window that is not going to be managed.
+ * prefetch_client_info() selected PropertyChangeMask on it, which is undone
+ * so its property changes stop waking us up, unless the window is gone */
+void forget_pending_client(Display* display, int index, bool destroyed)
+{
+        if (!destroyed) {
+                ignore_errors_begin(display);
+                XSelectInput(display, pending_clients[index].window, NoEventMask);
+                ignore_errors_end(display);
+        }
+        discard_client_query(display, &pending_clients[index]);
+        remove_pending_client(index);
+}
+
+
+/* starts reading a newly created top level window so the replies are ready by the time it is mapped */
+void prefetch_client_info(Display* display, Window window)
+{
+        if (find_pending_client(window) >= 0 || find_frame_by_component(window, NULL))
+                return;
+
+        if (num_pending_clients == MAX_PENDING_CLIENTS)
+                forget_pending_client(display, 0, false);
+
+        /* hear about property changes made before the window is mapped, the window
+         * may already be gone again by the time the server sees this */
+        ignore_errors_begin(display);
+        XSelectInput(display, window, PropertyChangeMask);
+        ignore_errors_end(display);
+
+        query_client_info(display, window, &pending_clients[num_pending_clients++]);
+}
+
+
+void refresh_pending_client(Display* display, Window window, Atom atom)
+{
+        int index = find_pending_client(window);
+        if (index >= 0)
+                refresh_client_query(display, &pending_clients[index], atom);
+}
+
+
+void evict_pending_client(Display* display, Window window, bool destroyed)
+{
+        int index = find_pending_client(window);
+        if (index >= 0)
+                forget_pending_client(display, index, destroyed);
+}
+
+
+/* moves the prefetched query for window into query, if there is one */
+bool take_pending_client(Window window, NoteWM_ClientQuery* query)
+{
+        int index = find_pending_client(window);
+        if (index < 0)
+                return false;
+
+        *query = pending_clients[index];
+        remove_pending_client(index);
+        return true;
+}
+
@@ -1,6 +1,9 @@
 #include "notewm.h"
 
+#define CONFIG_PATH "/home/mace/.config/notewm/config.ini"
+
 unsigned long color_to_ulong(const char* color_str);
+void copy_config_string(char* dest, const char* value, unsigned int size);
 
 unsigned long color_to_ulong(const char* color_str)
 {
@@ -11,6 +14,13 @@ unsigned long color_to_ulong(const char* color_str)
         return strtoul(color_str, NULL, 16);
 }
 
+void copy_config_string(char* dest, const char* value, unsigned int size)
+{
+        strncpy(dest, value, size - 1);
+        dest[size - 1] = '\0';
+}
+
+
 int conf_handler(void* user, const char* section, const char* name, const char* value)
 {
         NoteWM_Config* pconfig = (NoteWM_Config*)user;
@@ -31,7 +41,45 @@ int conf_handler(void* user, const char* section, const char* name, const char*
                 pconfig->expand_color = color_to_ulong(value);
         else if (MATCH("Colors", "button-split"))
                 pconfig->split_color = color_to_ulong(value);
+        else if (MATCH("Behaviour", "drag-rate"))
+                pconfig->drag_rate = strtoul(value, NULL, 10);
+        else if (MATCH("Behaviour", "title-rate"))
+                pconfig->title_rate = strtoul(value, NULL, 10);
+        else if (MATCH("Behaviour", "decoration-pool"))
+                pconfig->decoration_pool_size = strtoul(value, NULL, 10);
+        else if (MATCH("Behaviour", "single-window-decorations"))
+                pconfig->single_window_decorations = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        else if (MATCH("Appearance", "font"))
+                copy_config_string(pconfig->font, value, sizeof(pconfig->font));
+        else if (MATCH("Commands", "launcher"))
+                copy_config_string(pconfig->launcher_command, value, sizeof(pconfig->launcher_command));
+        else if (MATCH("Commands", "terminal"))
+                copy_config_string(pconfig->terminal_command, value, sizeof(pconfig->terminal_command));
         else
                 return 0;
         return 1;
 }
+
+
+/* resets conf to the defaults and then applies config.ini on top of them */
+void load_config(NoteWM_Config* conf)
+{
+        memset(conf, 0, sizeof(*conf));
+        conf->title_bar_color = 0xeaffff;
+        conf->button_border_color = 0x000000;
+        conf->border_color = 0x55aaaa;
+        conf->fg_color = 0x000000;
+        conf->bg_color = 0xffffea;
+        conf->close_color = 0xffaaaa;
+        conf->expand_color = 0xeeee9e;
+        conf->split_color = 0x88cc88;
+        conf->drag_rate = 60;
+        conf->title_rate = 10;
+        conf->decoration_pool_size = 4;
+        strcpy(conf->launcher_command, "dmenu_run -fn 'Droid Sans Mono-12' -nb black -sb '#ffffff' -l 5");
+        strcpy(conf->terminal_command, "xfce4-terminal");
+
+        if (ini_parse(CONFIG_PATH, conf_handler, conf) < 0) {
+                fprintf(stderr, "Failed to load config.ini, using default settings.\n");
+        }
+}
@@ -0,0 +1,115 @@
+/*
+ * file: decoration_pool.c
+ * -----------------------
+ * This file contains the pool of spare decoration trees. A tree is a frame
+ * window with its title bar, title string window and buttons, created
+ * unmapped and left out of the window index. create_frame() takes one from
+ * the pool and only has to move it into place, and a frame whose client has
+ * already gone is put back instead of being destroyed, so dialogs and other
+ * short lived windows do not pay for creating and destroying seven windows.
+ *
+ * The pool is filled back up to decoration-pool trees whenever NoteWM is
+ * about to wait for events.
+ *
+ * Author: Mason Armand
+ * Date Created: Jun 1, 2023
+ * Last Modified: Jun 8, 2023
+ */
+#include "notewm.h"
+
+/* size of the pooled trees, create_frame() resizes them for the client */
+#define POOL_FRAME_SIZE 100
+
+/* spare trees, linked through their next pointer */
+static NoteWM_Frame* pool = NULL;
+static unsigned int pool_count = 0;
+
+
+/* returns a spare tree, or NULL if the pool is empty */
+NoteWM_Frame* take_decorations(void)
+{
+        NoteWM_Frame* frame = pool;
+
+        if (!frame)
+                return NULL;
+
+        pool = frame->next;
+        pool_count--;
+        frame->next = NULL;
+        return frame;
+}
+
+
+/* puts the decorations of a frame without a client back into the pool. the
+ * frame must already be out of the window index and the frame lists.
+ * returns false if they cannot be reused and have to be destroyed */
+bool return_decorations(Display* display, NoteWM_Frame* frame)
+{
+        /* trees built with an older theme or the other decoration mode would
+         * have to be rebuilt anyway */
+        if (pool_count >= global_state.conf.decoration_pool_size
+        || frame->theme != global_theme
+        || (frame->title_string_window == None) != global_state.conf.single_window_decorations)
+                return false;
+
+        /* nobody manages the frame anymore, so its UnmapNotify is not wanted */
+        XSelectInput(display, frame->frame, NoEventMask);
+        if (frame->is_mapped)
+                XUnmapWindow(display, frame->frame);
+
+        if (frame->title_pixmap != None)
+                XFreePixmap(display, frame->title_pixmap);
+        frame->title_pixmap = None;
+        frame->title_pixmap_w = 0;
+        frame->title[0] = '\0';
+        frame->title_pending = false;
+        frame->title_update_time = 0;
+        frame->child_window = None;
+
+        frame->next = pool;
+        pool = frame;
+        pool_count++;
+        return true;
+}
+
+
+/* creates trees until the pool is full. the requests are only queued, so
+ * this never waits on the server */
+void refill_decoration_pool(Display* display, Window root)
+{
+        NoteWM_Frame* frame;
+
+        while (pool_count < global_state.conf.decoration_pool_size) {
+                frame = alloc_frame();
+                set_frame_geometry(frame, 0, 0, POOL_FRAME_SIZE, POOL_FRAME_SIZE);
+                frame->child_window = None;
+                create_frame_window(display, root, frame);
+                create_title_bar(display, frame);
+
+                frame->next = pool;
+                pool = frame;
+                pool_count++;
+        }
+}
+
+
+/* destroys every spare tree, for when the theme changes or NoteWM exits */
+void drain_decoration_pool(Display* display)
+{
+        NoteWM_Frame* frame;
+
+        while ((frame = take_decorations()))
+                destroy_decorations(display, frame);
+}
+
+
+bool is_pooled_window(Window window)
+{
+        NoteWM_Frame* frame;
+
+        for (frame = pool; frame; frame = frame->next) {
+                if (frame->frame == window)
+                        return true;
+        }
+        return false;
+}
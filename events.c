@@ -11,7 +11,8 @@
 
 void handle_close_button(Display* display, Window root, NoteWM_Frame* frame, NoteWM_Frame** list)
 {
-        close_frame(display, root, frame, list);
+        (void) root;
+        close_frame(display, frame, list);
 }
 
 
@@ -66,7 +67,7 @@ void handle_split_right_button(Display* display, Window root, NoteWM_Frame* fram
 }
 
 
-void handle_key_press(Display* display, Window root, XKeyEvent* e, NoteWM_Frame* list)
+void handle_key_press(Display* display, Window root, XKeyEvent* e)
 {
         unsigned short workspace_id;
 
@@ -74,7 +75,7 @@ void handle_key_press(Display* display, Window root, XKeyEvent* e, NoteWM_Frame*
         && (e->keycode >= XKeysymToKeycode(display, XK_1))
         && (e->keycode <= XKeysymToKeycode(display, XK_9))) {
                 workspace_id = e->keycode - XKeysymToKeycode(display, XK_1);
-                switch_to_workspace(display, root, workspace_id, list);
+                switch_to_workspace(display, root, workspace_id);
                 printf("Switched to workspace: %d\n", workspace_id);
         }
 }
@@ -83,7 +84,9 @@ void handle_key_press(Display* display, Window root, XKeyEvent* e, NoteWM_Frame*
 void handle_button_press(Display* display, Window root, XButtonEvent* e, NoteWM_Frame** list)
 {
         NoteWM_Frame* frame;
-        unsigned int i;
+        NoteWM_Component component;
+        NoteWM_IndexEntry* entry;
+        int button = -1;
 
         /* start blitting a window */
         /*
@@ -93,7 +96,7 @@ void handle_button_press(Display* display, Window root, XButtonEvent* e, NoteWM_
                 blitting = true;
         }*/
 
-        frame = find_frame_by_component(e->subwindow, *list);
+        frame = find_frame_by_component(e->subwindow, NULL);
         if (frame) {
                 if (e->button == Button1)
                         grab_change_cursor(display, frame->frame, global_cursor_grab);
@@ -102,63 +105,109 @@ void handle_button_press(Display* display, Window root, XButtonEvent* e, NoteWM_
 
                 XRaiseWindow(display, frame->frame);
                 XSetInputFocus(display, frame->child_window, RevertToParent, CurrentTime);
+                ignore_crossing_events(display);
         }
 
-        if (!(frame = find_frame_by_component(e->window, *list)))
+        if (!(entry = lookup_window(e->window)))
                 return;
+        frame = entry->frame;
+        component = entry->component;
 
         /* set focus to clicked window */
         XSetInputFocus(display, frame->child_window, RevertToParent, CurrentTime);
         XRaiseWindow(display, frame->frame);
+        ignore_crossing_events(display);
 
-        for (i = 0; i < frame->button_list->count; i++) {
-                if (e->window == frame->button_list->buttons[i].window) {
-                        frame->button_list->buttons[i].on_click(display, root, frame, list);
-                        break;
-                }
-        }
+        if (component == COMPONENT_BUTTON)
+                button = entry->button_index;
+        else if (component == COMPONENT_TITLE_BAR && frame->title_string_window == None)
+                button = find_button_at(frame, e->x, e->y);
+
+        if (button >= 0)
+                frame->button_list.buttons[button].on_click(display, root, frame, list);
 }
 
 
-void handle_motion_notify(Display* display, XButtonEvent* e, NoteWM_WindowResizeInfo r_info, NoteWM_Frame* list)
+void handle_motion_notify(Display* display, XMotionEvent* e, NoteWM_WindowResizeInfo* r_info)
 {
-        XWindowAttributes attrs = r_info.attrs;
-        XButtonEvent start = r_info.event;
+        if (r_info->event.subwindow == None)
+                return;
+
+        /* only remember where the pointer is, the frame is moved when the
+         * next drag update is due */
+        r_info->x_root = e->x_root;
+        r_info->y_root = e->y_root;
+        r_info->pending = true;
+        apply_pending_motion(display, r_info, false);
+}
+
+
+void apply_pending_motion(Display* display, NoteWM_WindowResizeInfo* r_info, bool force)
+{
+        XButtonEvent start = r_info->event;
         NoteWM_Frame* frame;
+        unsigned long now;
+
+        if (!r_info->pending)
+                return;
+
+        now = get_time_ms();
+        if (!force && pending_motion_timeout(r_info) > 0)
+                return;
+
+        r_info->pending = false;
+        r_info->last_update = now;
 
         /* move and resize frame window */
-        if ((frame = find_frame_by_component(start.subwindow, list))) {
-                int dx = e->x_root - start.x_root;
-                int dy = e->y_root - start.y_root;
+        if ((frame = find_frame_by_component(start.subwindow, NULL))) {
+                int dx = r_info->x_root - start.x_root;
+                int dy = r_info->y_root - start.y_root;
 
                 frame->is_fullscreen = false;
 
                 move_resize_frame(
                         display, frame,
-                        attrs.x + (start.button == 1 ? dx : 0),
-                        attrs.y + (start.button == 1 ? dy : 0),
-                        attrs.width + (start.button == 3 ? dx : 0),
-                        attrs.height + (start.button == 3 ? dy : 0)
+                        r_info->x + (start.button == 1 ? dx : 0),
+                        r_info->y + (start.button == 1 ? dy : 0),
+                        r_info->w + (start.button == 3 ? dx : 0),
+                        r_info->h + (start.button == 3 ? dy : 0)
                 );
         }
 }
 
 
+/* returns how many milliseconds until the pending drag update may be applied,
+ * or -1 if there is nothing pending */
+long pending_motion_timeout(NoteWM_WindowResizeInfo* r_info)
+{
+        unsigned long interval;
+        unsigned long elapsed;
+
+        if (!r_info->pending)
+                return -1;
+        if (global_state.conf.drag_rate == 0)
+                return 0;
+
+        interval = 1000 / global_state.conf.drag_rate;
+        elapsed = get_time_ms() - r_info->last_update;
+
+        return (elapsed >= interval) ? 0 : (long) (interval - elapsed);
+}
+
+
 void send_configure_notify(Display* display, NoteWM_Frame* frame)
 {
         XConfigureEvent ce;
-        XWindowAttributes attrs;
-
-        XGetWindowAttributes(display, frame->frame, &attrs);
 
         ce.type = ConfigureNotify;
         ce.event = frame->child_window;
         ce.window = frame->child_window;
 
-        ce.x = 0;
-        ce.y = 0;
-        ce.width = attrs.width;
-        ce.height = attrs.height - TITLE_HEIGHT - (BORDER_WIDTH * 2);
+        /* synthetic ConfigureNotify events carry root relative coordinates */
+        ce.x = frame->x + BORDER_WIDTH;
+        ce.y = frame->y + BORDER_WIDTH + CLIENT_OFFSET_Y;
+        ce.width = frame->client_w;
+        ce.height = frame->client_h;
         ce.border_width = 0;
         ce.above = None;
         ce.override_redirect = False;
@@ -167,43 +216,68 @@ void send_configure_notify(Display* display, NoteWM_Frame* frame)
 }
 
 
-void handle_unmap_notify(Display* display, Window root, XUnmapEvent* e, NoteWM_Frame** list)
+void handle_unmap_notify(Display* display, Window root, XUnmapEvent* e)
 {
-        NoteWM_Frame* frame = find_frame_by_component(e->window, *list);
-        printf("unmap notify on %ld\n", e->window);
-        if (e->event == root || !is_valid_window(display, e->window))
+        NoteWM_Component component;
+        NoteWM_Frame* frame = find_frame_by_component(e->window, &component);
+
+        if (e->event == root)
                 return;
 
-        if (frame) {
-                XUnmapWindow(display, frame->frame);
+        if (frame && component == COMPONENT_FRAME && frame->ignore_unmap > 0) {
+                frame->ignore_unmap--;
+                return;
         }
-        else {
+        if (frame && component == COMPONENT_CHILD && frame->ignore_child_unmap > 0) {
+                frame->ignore_child_unmap--;
+                return;
+        }
+        printf("unmap notify on %ld\n", e->window);
+
+        /* the window may be destroyed right after unmapping, in which case
+         * the DestroyNotify is still in the queue and these requests fail */
+        ignore_errors_begin(display);
+        if (frame && component == COMPONENT_CHILD) {
+                frame->child_mapped = false;
+                unmap_frame(display, frame);
+        }
+        else if (!frame) {
                 XUnmapWindow(display, e->window);
         }
+        ignore_errors_end(display);
 }
 
 
 void handle_map_request(Display* display, Window root, XMapRequestEvent* e, NoteWM_Frame** list)
 {
-        NoteWM_Frame* frame = find_frame_by_component(e->window, *list);
+        NoteWM_Frame* frame = find_frame_by_component(e->window, NULL);
         printf("Map request on %ld\n", e->window);
         if (frame) {
-                XMapWindow(display, frame->frame);
+                frame->child_mapped = true;
+                if (frame->workspace_id == global_state.current_workspace)
+                        map_frame(display, frame);
                 XMapWindow(display, frame->child_window);
+                ignore_crossing_events(display);
                 return;
         }
         map_window(display, root, e->window, list);
 }
 
 
-void handle_configure_request(Display* display, XConfigureRequestEvent* e, NoteWM_Frame* list)
+void handle_configure_request(Display* display, XConfigureRequestEvent* e)
 {
-        NoteWM_Frame* frame = find_frame_by_component(e->window, list);
+        NoteWM_Frame* frame = find_frame_by_component(e->window, NULL);
         XWindowChanges changes;
 
         if (frame && !frame->ignore_configure_events) {
-                XMoveWindow(display, frame->frame, e->x, e->y);
-                resize_frame(display, frame, e->width, e->height + TITLE_HEIGHT, true);
+                /* fields missing from value_mask hold the client's position
+                 * inside the frame, so only honour the ones it asked for */
+                move_frame(
+                        display, frame,
+                        (e->value_mask & CWX) ? e->x : frame->x,
+                        (e->value_mask & CWY) ? e->y : frame->y
+                );
+                resize_frame(display, frame, e->width, e->height + CLIENT_OFFSET_Y, true);
                 return;
         }
         else if (frame && frame->ignore_configure_events) {
@@ -224,91 +298,112 @@ void handle_configure_request(Display* display, XConfigureRequestEvent* e, NoteW
 }
 
 
-void handle_destroy_notify(Display* display, Window root, XDestroyWindowEvent* e, NoteWM_Frame** list)
+void handle_destroy_notify(Display* display, XDestroyWindowEvent* e, NoteWM_Frame** list)
 {
-        NoteWM_Frame* frame = find_frame_by_component(e->window, *list);
+        NoteWM_Component component;
+        NoteWM_Frame* frame = find_frame_by_component(e->window, &component);
 
         printf("destroy notify event on %ld\n", e->window);
+        evict_pending_client(display, e->window, true);
 
+        /* frame windows are destroyed by free_frame, and any other window
+         * this is reported for is already gone */
         if (frame) {
-                if (is_valid_window(display, frame->frame)) {
-                        XDestroyWindow(display, frame->frame);
-                }
-                remove_client_window(display, root, frame->child_window);
+                frame->child_released = (component == COMPONENT_CHILD);
+                remove_client_window(frame);
                 remove_frame(display, frame, list);
-        }
-        else if (is_valid_window(display, e->window)) {
-                XDestroyWindow(display, e->window);
+                global_state.revert_focus = true;
         }
 }
 
 
-void handle_resize_request(Display* display, XResizeRequestEvent* e, NoteWM_Frame* list)
+void handle_resize_request(Display* display, XResizeRequestEvent* e)
 {
-        NoteWM_Frame* frame = find_frame_by_component(e->window, list);
+        NoteWM_Frame* frame = find_frame_by_component(e->window, NULL);
 
         if (frame) {
-                int new_width = e->width + (2 * BORDER_WIDTH);
-                int new_height = e->height + TITLE_HEIGHT + (2 * BORDER_WIDTH);
-                resize_frame(display, frame, new_width, new_height, true);
+                resize_frame(display, frame, e->width, e->height + CLIENT_OFFSET_Y, true);
                 return;
         }
         XResizeWindow(display, e->window, e->width, e->height);
 }
 
 
-void handle_property_notify(Display* display, XPropertyEvent* e, NoteWM_Frame* list)
+void handle_create_notify(Display* display, Window root, XCreateWindowEvent* e)
 {
-        NoteWM_Frame* frame = find_frame_by_component(e->window, list);
-        char window_name[256];
+        /* spare decorations are created as top level windows too */
+        if (e->parent == root && !e->override_redirect && !is_pooled_window(e->window))
+                prefetch_client_info(display, e->window);
+}
 
-        if (!frame)
+
+void handle_configure_notify(Display* display, XConfigureEvent* e)
+{
+        NoteWM_Component component;
+        NoteWM_Frame* frame = find_frame_by_component(e->window, &component);
+
+        if (!frame) {
+                refresh_pending_client(display, e->window, None);
                 return;
+        }
+
+        /* echoes of our own older requests would roll the geometry back */
+        if (component != COMPONENT_FRAME || e->serial < frame->geometry_serial)
+                return;
+
+        set_frame_geometry(frame, e->x, e->y, e->width, e->height);
+}
+
+
+void handle_property_notify(Display* display, XPropertyEvent* e)
+{
+        NoteWM_Component component;
+        NoteWM_Frame* frame = find_frame_by_component(e->window, &component);
 
-        switch (e->atom) {
-        case XA_WM_TRANSIENT_FOR:
-                break;
-        case XA_WM_NAME:
-                get_window_name(display, frame->child_window, window_name, sizeof(window_name));
-                printf("new name: %s\n", window_name);
-                update_frame_text(display, frame);
-        default: break;
+        if (!frame) {
+                refresh_pending_client(display, e->window, e->atom);
+                return;
         }
-        if (e->atom == _NET_WM_WINDOW_TYPE)
-                update_window_type(display, frame->child_window);
+        if (component != COMPONENT_CHILD)
+                return;
+
+        /* the cached copy is only read again when something needs it */
+        invalidate_frame_property(frame, e->atom);
+
+        if (e->atom == XA_WM_NAME || e->atom == global_atoms[ATOM_NET_WM_NAME])
+                schedule_title_update(frame);
+        else if (e->atom == global_atoms[ATOM_NET_WM_WINDOW_TYPE])
+                update_window_type(display, frame);
 }
 
 
 void handle_client_message(Display* display, Window root, XClientMessageEvent* e, NoteWM_Frame** list)
 {
-        NoteWM_Frame* frame = find_frame_by_component(e->window, *list);
-        Atom net_current_desktop = XInternAtom(display, "_NET_CURRENT_DESKTOP", false);
+        NoteWM_Frame* frame = find_frame_by_component(e->window, NULL);
 
-        if (e->message_type == net_current_desktop) {
+        if (e->message_type == global_atoms[ATOM_NET_CURRENT_DESKTOP]) {
                 int new_workspace = e->data.l[0];
-                switch_to_workspace(display, root, new_workspace, *list);
+                switch_to_workspace(display, root, new_workspace);
         }
 
         if (!frame)
                 return;
 
-        if (e->message_type == WM_PROTOCOLS) {
-                if (e->data.l[0] == (long int) WM_DELETE_WINDOW) {
-                        XDestroyWindow(display, frame->frame);
-                        remove_client_window(display, root, frame->child_window);
+        if (e->message_type == global_atoms[ATOM_WM_PROTOCOLS]) {
+                if (e->data.l[0] == (long int) global_atoms[ATOM_WM_DELETE_WINDOW]) {
+                        remove_client_window(frame);
                         remove_frame(display, frame, list);
                 }
         }
-        else if (e->message_type == _NET_WM_STATE) {
-                if (e->data.l[1] == (long int) _NET_WM_STATE_FULLSCREEN
-                ||  e->data.l[2] == (long int) _NET_WM_STATE_FULLSCREEN) {
+        else if (e->message_type == global_atoms[ATOM_NET_WM_STATE]) {
+                if (e->data.l[1] == (long int) global_atoms[ATOM_NET_WM_STATE_FULLSCREEN]
+                ||  e->data.l[2] == (long int) global_atoms[ATOM_NET_WM_STATE_FULLSCREEN]) {
                         bool fullscreen = (e->data.l[0] == 1 || (e->data.l[0] == 2 && !frame->is_fullscreen));
                         set_frame_fullscreen(display, frame, fullscreen);
                 }
         }
-        else if (e->message_type == _NET_CLOSE_WINDOW) {
-                XDestroyWindow(display, frame->frame);
-                remove_client_window(display, root, frame->child_window);
+        else if (e->message_type == global_atoms[ATOM_NET_CLOSE_WINDOW]) {
+                remove_client_window(frame);
                 remove_frame(display, frame, list);
         }
 }
@@ -316,9 +411,11 @@ void handle_client_message(Display* display, Window root, XClientMessageEvent* e
 
 void handle_reparent_notify(Display* display, Window root, XReparentEvent* e, NoteWM_Frame** list)
 {
-        NoteWM_Frame* frame = find_frame_by_component(e->window, *list);
-        (void) display;
+        NoteWM_Frame* frame = find_frame_by_component(e->window, NULL);
         printf("reparent notify\n");
+        /* a prefetched query is only good for top level windows */
+        if (e->parent != root)
+                evict_pending_client(display, e->window, false);
         if(e->parent == root) {
                 printf("reparented to root\n");
                 if (!frame) {
@@ -326,7 +423,7 @@ void handle_reparent_notify(Display* display, Window root, XReparentEvent* e, No
                 }
         }
         else {
-                NoteWM_Frame* new_parent_frame = find_frame_by_component(e->parent, *list);
+                NoteWM_Frame* new_parent_frame = find_frame_by_component(e->parent, NULL);
                 printf("reparented to other window\n");
                 if (new_parent_frame)
                         printf("reparented to frame");
@@ -334,18 +431,23 @@ void handle_reparent_notify(Display* display, Window root, XReparentEvent* e, No
                         printf("reparented to somethin??");
                 if (frame && !new_parent_frame) {
                         printf("no longer managing frame\n");
-                        remove_client_window(display, root, frame->child_window);
+                        frame->child_released = true;
+                        remove_client_window(frame);
                         remove_frame(display, frame, list);
                 }
         }
 }
 
 
-void handle_enter_notify(Display* display, Window root, XCrossingEvent* e, NoteWM_Frame* list)
+void handle_enter_notify(Display* display, Window root, XCrossingEvent* e)
 {
+        /* the pointer did not move, a window appeared or moved under it */
+        if (e->serial <= global_state.ignore_crossing_serial)
+                return;
+
         if (e->window == root) {
                 XSetInputFocus(display, root, RevertToPointerRoot, CurrentTime);
                 return;
         }
-        focus_window(display, e->window, list);
+        focus_window(display, e->window);
 }
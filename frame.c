@@ -10,11 +10,48 @@
  */
 #include "notewm.h"
 
+#define TITLE_WINDOW_HEIGHT (TITLE_HEIGHT + (PADDING * 2))
+
+Window title_window(NoteWM_Frame* frame);
+int title_width(NoteWM_Frame* frame);
+int title_height(NoteWM_Frame* frame);
+void draw_buttons(Display* display, NoteWM_Frame* frame);
+int button_x(NoteWM_Frame* frame, unsigned int index);
+bool render_frame_title(Display* display, NoteWM_Frame* frame);
+void unlink_dirty_frame(NoteWM_Frame* frame);
+void link_pending_title(NoteWM_Frame* frame);
+void unlink_pending_title(NoteWM_Frame* frame);
+void init_decorations(NoteWM_Frame* frame);
+void select_decoration_input(Display* display, NoteWM_Frame* frame);
+void init_button(NoteWM_Frame* frame, unsigned int index, NoteWM_Button* button);
+void apply_theme(Display* display, NoteWM_Frame* frame);
+void paint_frame(Display* display, NoteWM_Frame* frame, unsigned int dirty);
+
+long title_wait(NoteWM_Frame* frame, unsigned long now);
+
+/* the buttons of every title bar, from right to left */
+static const struct {
+        NoteWM_ButtonStyle style;
+        ButtonClickFunc on_click;
+} title_buttons[NUM_TITLE_BUTTONS] = {
+        { BUTTON_CLOSE, handle_close_button },
+        { BUTTON_EXPAND, handle_expand_button },
+        { BUTTON_SPLIT, handle_split_right_button },
+        { BUTTON_SPLIT, handle_split_left_button }
+};
+
+/* frames with decorations waiting for the next paint pass, linked through dirty_next */
+static NoteWM_Frame* dirty_frames = NULL;
+/* frames with title_pending set on each workspace, linked through title_next,
+ * so the title pass only looks at frames that are visible and waiting */
+static NoteWM_Frame* pending_titles[NUM_WORKSPACES];
+
 /* ---------- Linked List Functions ---------- */
 void add_frame(NoteWM_Frame* frame, NoteWM_Frame** list)
 {
         frame->next = *list;
         *list = frame;
+        attach_frame_to_workspace(frame, frame->workspace_id);
 }
 
 
@@ -31,6 +68,10 @@ void remove_frame(Display* display, NoteWM_Frame* frame, NoteWM_Frame** list)
                         else {
                                 prev->next = current->next;
                         }
+                        unindex_frame(frame);
+                        detach_frame_from_workspace(frame);
+                        unlink_dirty_frame(frame);
+                        frame->title_pending = false;
                         free_frame(display, frame);
                         return;
                 }
@@ -40,103 +81,167 @@ void remove_frame(Display* display, NoteWM_Frame* frame, NoteWM_Frame** list)
 }
 
 
+void attach_frame_to_workspace(NoteWM_Frame* frame, unsigned short workspace_id)
+{
+        NoteWM_Frame** head = &global_state.workspaces[workspace_id];
+
+        frame->workspace_id = workspace_id;
+        frame->ws_prev = NULL;
+        frame->ws_next = *head;
+        if (*head)
+                (*head)->ws_prev = frame;
+        *head = frame;
+
+        if (frame->title_pending)
+                link_pending_title(frame);
+}
+
+
+void detach_frame_from_workspace(NoteWM_Frame* frame)
+{
+        if (frame->ws_prev)
+                frame->ws_prev->ws_next = frame->ws_next;
+        else
+                global_state.workspaces[frame->workspace_id] = frame->ws_next;
+
+        if (frame->ws_next)
+                frame->ws_next->ws_prev = frame->ws_prev;
+
+        frame->ws_prev = NULL;
+        frame->ws_next = NULL;
+
+        if (frame->title_pending)
+                unlink_pending_title(frame);
+}
+
+
 void free_frame(Display* display, NoteWM_Frame* frame)
 {
-        if (is_valid_window(display, frame->frame))
-                XDestroyWindow(display, frame->frame);
+        /* once the client has left the frame, its decorations can be
+         * handed to the next client instead of being destroyed */
+        if (frame->child_released && return_decorations(display, frame))
+                return;
 
-        if(frame->button_list) {
-                if(frame->button_list->buttons) {
-                        free(frame->button_list->buttons);
-                        frame->button_list->buttons = NULL;
-                }
-                free(frame->button_list);
-        }
+        destroy_decorations(display, frame);
+}
+
+
+void destroy_decorations(Display* display, NoteWM_Frame* frame)
+{
+        /* the frame window belongs to us and is only ever destroyed here */
+        XDestroyWindow(display, frame->frame);
 
-        XFreeGC(display, frame->gc);
+        if (frame->title_pixmap != None)
+                XFreePixmap(display, frame->title_pixmap);
+        release_theme(display, frame->theme);
 
-        free(frame);
+        dealloc_frame(frame);
 }
 
 
-NoteWM_Frame* find_frame_by_component(Window component, NoteWM_Frame* list)
+NoteWM_Frame* find_frame_by_component(Window component, NoteWM_Component* type)
 {
-        NoteWM_Frame* current = list;
-        while (current != NULL) {
-                if (current->frame == component
-                || current->title_bar == component
-                || current->child_window == component
-                || is_button(component, current)) {
+        NoteWM_IndexEntry* entry = lookup_window(component);
 
-                        return current;
-                }
-                current = current->next;
-        }
-        return NULL;
+        if (!entry)
+                return NULL;
+
+        if (type)
+                *type = entry->component;
+        return entry->frame;
 }
 
 
 bool is_button(Window window, NoteWM_Frame* frame)
 {
-        unsigned int i;
-        for (i = 0; i < frame->button_list->count; i++) {
-                if (window == frame->button_list->buttons[i].window) {
-                        return true;
-                }
-        }
-        return false;
+        NoteWM_IndexEntry* entry = lookup_window(window);
+        return (entry && entry->frame == frame && entry->component == COMPONENT_BUTTON);
 }
 
 
 /* ---------- Frame Window Creation Functions ---------- */
-NoteWM_Frame* create_frame(Display* display, Window window, Window root)
+NoteWM_Frame* create_frame(Display* display, NoteWM_ClientInfo* info, Window root)
 {
-        NoteWM_Frame* frame;
-        XWindowAttributes attrs;
-        XSizeHints hints;
-        long msize;
         int f_width = 100;
         int f_height = 100;
 
-        XGetWindowAttributes(display, window, &attrs);
-
-        if (XGetWMNormalHints(display, window, &hints, &msize) && (hints.flags & PSize) && hints.width != 0) {
-                f_width = hints.width;
-                f_height = hints.height + TITLE_HEIGHT;
-        } else if (attrs.width != 0 && attrs.height != 0) {
-                f_width = attrs.width;
-                f_height = attrs.height + TITLE_HEIGHT;
-        }
-        else {
-                XResizeWindow(display, window, f_width, f_height - TITLE_HEIGHT);
+        if (info->has_size_hint) {
+                f_width = info->hint_width;
+                f_height = info->hint_height + CLIENT_OFFSET_Y;
+        } else if (info->width != 0 && info->height != 0) {
+                f_width = info->width;
+                f_height = info->height + CLIENT_OFFSET_Y;
         }
 
-        frame = malloc(sizeof(NoteWM_Frame));
+        return create_frame_at(display, info, root, info->x, info->y, f_width, f_height, true);
+}
+
+
+/* frames the client with the frame window at the given geometry. the client
+ * and its frame are left unmapped if map_client is false */
+NoteWM_Frame* create_frame_at(Display* display, NoteWM_ClientInfo* info, Window root, int x, int y, int width, int height, bool map_client)
+{
+        NoteWM_Frame* frame;
+        Window window = info->window;
+        bool pooled;
+
+        /* a spare decoration tree only has to be moved into place, which
+         * saves creating the seven windows while the client waits to map */
+        frame = take_decorations();
+        pooled = (frame != NULL);
+        if (!pooled)
+                frame = alloc_frame();
+
+        set_frame_geometry(frame, x, y, width, height);
         frame->is_fullscreen = false;
+        frame->ignore_configure_events = false;
+        frame->child_mapped = map_client;
+        frame->child_released = false;
+        frame->ignore_unmap = 0;
+        /* everything about the client was read in the same round trip as the
+         * rest of map_window, so the cache starts out fresh */
+        frame->info = *info;
+        frame->stale_properties = 0;
+        /* reparenting a mapped window unmaps it */
+        frame->ignore_child_unmap = (info->map_state != IsUnmapped) ? 1 : 0;
         frame->child_window = window;
+        /* a window that already has a desktop, for example from before a
+         * restart, goes back to it */
         frame->workspace_id = global_state.current_workspace;
-
-        frame->frame = XCreateSimpleWindow(
-                display, root,
-                attrs.x, attrs.y,
-                f_width, f_height,
-                BORDER_WIDTH, global_state.conf.border_color, global_state.conf.bg_color
-        );
-
-        create_title_bar(display, frame);
+        if (info->desktop >= 0 && info->desktop < NUM_WORKSPACES)
+                frame->workspace_id = info->desktop;
+        frame->is_mapped = map_client && (frame->workspace_id == global_state.current_workspace);
+
+        if (pooled) {
+                XMoveResizeWindow(display, frame->frame, frame->x, frame->y, frame->w, frame->h);
+                XResizeWindow(display, frame->title_bar, frame->w, TITLE_HEIGHT);
+                /* the buttons were laid out for the pool's placeholder width */
+                mark_frame_dirty(frame, DIRTY_TITLE | DIRTY_BUTTONS);
+        }
+        else {
+                create_frame_window(display, root, frame);
+                create_title_bar(display, frame);
+                mark_frame_dirty(frame, DIRTY_TITLE);
+        }
+        index_frame(frame);
 
         XSelectInput(display, window, StructureNotifyMask | PropertyChangeMask | EnterWindowMask);
         XSelectInput(display, frame->frame, StructureNotifyMask);
 
-        XReparentWindow(display, window, frame->frame, 0, 0);
+        /* if NoteWM goes away, the server puts the client back on the root window */
+        XAddToSaveSet(display, window);
+        XReparentWindow(display, window, frame->frame, 0, CLIENT_OFFSET_Y);
+        XResizeWindow(display, window, frame->client_w, frame->client_h);
 
-        XMapWindow(display, frame->frame);
-        XMapWindow(display, window);
-
-        XMoveWindow(display, window, 0, 0 + TITLE_HEIGHT + BORDER_WIDTH);
+        if (frame->is_mapped)
+                XMapWindow(display, frame->frame);
+        if (map_client)
+                XMapWindow(display, window);
+        frame->geometry_serial = NextRequest(display) - 1;
+        ignore_crossing_events(display);
 
         set_net_wm_desktop(display, window, frame->workspace_id);
-        add_client_window(display, root, window);
+        add_client_window(frame);
 
         frame->next = NULL;
         printf("created frame for window %ld %ld\n", window, frame->child_window);
@@ -145,93 +250,559 @@ NoteWM_Frame* create_frame(Display* display, Window window, Window root)
 }
 
 
-void create_title_bar(Display* display, NoteWM_Frame* frame)
+void create_frame_window(Display* display, Window root, NoteWM_Frame* frame)
 {
-        XWindowAttributes frame_attrs;
+        frame->frame = XCreateSimpleWindow(
+                display, root,
+                frame->x, frame->y,
+                frame->w, frame->h,
+                BORDER_WIDTH, global_state.conf.border_color, global_state.conf.bg_color
+        );
+}
 
-        XGetWindowAttributes(display, frame->frame, &frame_attrs);
+
+void create_title_bar(Display* display, NoteWM_Frame* frame)
+{
+        unsigned int i;
 
         frame->title_bar = XCreateSimpleWindow(
                 display, frame->frame,
                 -BORDER_WIDTH, -BORDER_WIDTH,
-                frame_attrs.width, TITLE_HEIGHT,
+                frame->w, TITLE_HEIGHT,
                 BORDER_WIDTH, global_state.conf.border_color, global_state.conf.title_bar_color
         );
 
-        frame->title_string_window = XCreateSimpleWindow(
-                display, frame->title_bar,
-                BORDER_WIDTH, BORDER_WIDTH,
-                frame_attrs.width - (PADDING * 2) - BUTTON_SIZE, TITLE_HEIGHT + (PADDING * 2),
-                0, global_state.conf.fg_color, global_state.conf.title_bar_color
-        );
+        if (global_state.conf.single_window_decorations) {
+                /* the title and the buttons are all drawn into the title bar
+                 * and clicks on the buttons are found by find_button_at() */
+                frame->title_string_window = None;
+        }
+        else {
+                frame->title_string_window = XCreateSimpleWindow(
+                        display, frame->title_bar,
+                        BORDER_WIDTH, BORDER_WIDTH,
+                        title_width(frame), title_height(frame),
+                        0, global_state.conf.fg_color, global_state.conf.title_bar_color
+                );
+                XMapWindow(display, frame->title_string_window);
+        }
 
-        frame->button_list = NULL;
-        frame->gc = XCreateGC(display, frame->title_string_window, 0, NULL);
-        XSetForeground(display, frame->gc, global_state.conf.fg_color);
-        XSetFont(display, frame->gc, global_font->fid);
+        /* the title is copied in from title_pixmap, so there is no need for the
+         * server to clear exposed areas first, which is what made it flicker */
+        XSetWindowBackgroundPixmap(display, title_window(frame), None);
+        init_decorations(frame);
+        select_decoration_input(display, frame);
 
-        XSelectInput(display, frame->title_bar, SubstructureRedirectMask | ButtonPressMask | ExposureMask);
         XMapWindow(display, frame->title_bar);
-        XMapWindow(display, frame->title_string_window);
 
-        create_button(display, frame, global_state.conf.close_color, ButtonPressMask, handle_close_button);
-        create_button(display, frame, global_state.conf.expand_color, ButtonPressMask, handle_expand_button);
-        create_button(display, frame, global_state.conf.split_color, ButtonPressMask, handle_split_right_button);
-        create_button(display, frame, global_state.conf.split_color, ButtonPressMask, handle_split_left_button);
-        update_frame_text(display, frame);
+        for (i = 0; i < NUM_TITLE_BUTTONS; i++)
+                create_button(display, frame, title_buttons[i].style, ButtonPressMask, title_buttons[i].on_click);
+}
+
+
+/* resets everything about the decorations that only lives in this process */
+void init_decorations(NoteWM_Frame* frame)
+{
+        frame->title_pixmap = None;
+        frame->title_pixmap_w = 0;
+        frame->title[0] = '\0';
+        frame->dirty = 0;
+        frame->dirty_next = NULL;
+        frame->title_pending = false;
+        frame->title_update_time = 0;
+        frame->button_list.count = 0;
+        frame->theme = acquire_theme(global_theme);
+}
+
+
+void select_decoration_input(Display* display, NoteWM_Frame* frame)
+{
+        if (frame->title_string_window == None) {
+                XSelectInput(display, frame->title_bar, SubstructureRedirectMask | ButtonPressMask | ExposureMask);
+        }
+        else {
+                XSelectInput(display, frame->title_bar, SubstructureRedirectMask | ButtonPressMask);
+                XSelectInput(display, frame->title_string_window, ExposureMask);
+        }
+}
+
+
+/* ---------- Restart Functions ---------- */
+/* stores what a new NoteWM process needs to frame the client again in
+ * record, which has RECORD_SIZE elements */
+void save_frame(NoteWM_Frame* frame, long* record)
+{
+        record[RECORD_CHILD] = frame->child_window;
+        record[RECORD_WORKSPACE] = frame->workspace_id;
+        record[RECORD_X] = frame->x;
+        record[RECORD_Y] = frame->y;
+        record[RECORD_W] = frame->w;
+        record[RECORD_H] = frame->h;
+        record[RECORD_RESTORE_X] = frame->restore_x;
+        record[RECORD_RESTORE_Y] = frame->restore_y;
+        record[RECORD_RESTORE_W] = frame->restore_w;
+        record[RECORD_RESTORE_H] = frame->restore_h;
+        record[RECORD_FLAGS] = (frame->is_fullscreen ? RECORD_FULLSCREEN : 0)
+                | (frame->child_mapped ? RECORD_CHILD_MAPPED : 0);
+        save_client_info(&frame->info, &record[RECORD_INFO]);
+}
+
+
+/* frames a client again as it was when save_frame() wrote record. info has
+ * the window's current attributes, its properties come from the record */
+NoteWM_Frame* restore_frame(Display* display, Window root, const long* record, NoteWM_ClientInfo* info)
+{
+        NoteWM_Frame* frame;
+        long flags = record[RECORD_FLAGS];
+
+        restore_client_info(&record[RECORD_INFO], info);
+        info->desktop = record[RECORD_WORKSPACE];
+        frame = create_frame_at(
+                display, info, root,
+                record[RECORD_X], record[RECORD_Y], record[RECORD_W], record[RECORD_H],
+                /* a client that had unmapped itself stays unmapped */
+                (flags & RECORD_CHILD_MAPPED) != 0
+        );
+
+        frame->restore_x = record[RECORD_RESTORE_X];
+        frame->restore_y = record[RECORD_RESTORE_Y];
+        frame->restore_w = record[RECORD_RESTORE_W];
+        frame->restore_h = record[RECORD_RESTORE_H];
+        frame->is_fullscreen = (flags & RECORD_FULLSCREEN) != 0;
+        return frame;
 }
 
+
 /* ---------- Frame Management Functions ---------- */
 
-void resize_frame(Display* display, NoteWM_Frame* frame, int width, int height, bool is_event)
+/* frames keep their own geometry so it never has to be read back from the server.
+ * x, y, width and height are the frame window's, the client sits below the title bar */
+void set_frame_geometry(NoteWM_Frame* frame, int x, int y, int width, int height)
 {
-        unsigned int i;
+        if (width < 1)
+                width = 1;
+        if (height < CLIENT_OFFSET_Y + 1)
+                height = CLIENT_OFFSET_Y + 1;
+
+        frame->x = x;
+        frame->y = y;
+        frame->w = width;
+        frame->h = height;
+        frame->client_w = width;
+        frame->client_h = height - CLIENT_OFFSET_Y;
+}
 
+
+void resize_frame(Display* display, NoteWM_Frame* frame, int width, int height, bool is_event)
+{
         if (!is_event)
                 frame->ignore_configure_events = true;
 
-        XResizeWindow(display, frame->frame, width, height);
-        XResizeWindow(display, frame->child_window, width, height - TITLE_HEIGHT);
-        XResizeWindow(display, frame->title_bar, width, TITLE_HEIGHT);
+        set_frame_geometry(frame, frame->x, frame->y, width, height);
 
-        for (i = 0; i < frame->button_list->count; i++) {
-                XMoveWindow(
-                        display, frame->button_list->buttons[i].window,
-                        width - (BUTTON_SIZE * (i + 1)) - (PADDING * (i + 1)),
-                        TITLE_HEIGHT - BUTTON_SIZE - PADDING
-                );
-        }
+        XResizeWindow(display, frame->frame, frame->w, frame->h);
+        XResizeWindow(display, frame->child_window, frame->client_w, frame->client_h);
+        XResizeWindow(display, frame->title_bar, frame->w, TITLE_HEIGHT);
+        frame->geometry_serial = NextRequest(display) - 1;
+
+        /* a drag resizes many times per batch, the decorations only need to
+         * catch up with the last one */
+        mark_frame_dirty(frame, DIRTY_TITLE | DIRTY_BUTTONS);
+}
+
+
+void move_frame(Display* display, NoteWM_Frame* frame, int x, int y)
+{
+        frame->x = x;
+        frame->y = y;
+        XMoveWindow(display, frame->frame, x, y);
+        frame->geometry_serial = NextRequest(display) - 1;
 }
 
 
 void move_resize_frame(Display* display, NoteWM_Frame* frame, int x, int y, int width, int height)
 {
         resize_frame(display, frame, width, height, false);
-        XMoveWindow(display, frame->frame, x, y);
+        move_frame(display, frame, x, y);
         /* notify the child of its new size and position, so that things like mouse input
          * don't behave as if the window is at (0,0) */
         send_configure_notify(display, frame);
+        ignore_crossing_events(display);
+}
+
+
+void map_frame(Display* display, NoteWM_Frame* frame)
+{
+        if (frame->is_mapped)
+                return;
+
+        XMapWindow(display, frame->frame);
+        frame->is_mapped = true;
+}
+
+
+void unmap_frame(Display* display, NoteWM_Frame* frame)
+{
+        /* unmapping an unmapped window generates no event, so only count
+         * the UnmapNotify we are actually going to receive */
+        if (!frame->is_mapped)
+                return;
+
+        XUnmapWindow(display, frame->frame);
+        frame->is_mapped = false;
+        frame->ignore_unmap++;
+}
+
+
+/* the window the title is drawn into, which is the title bar itself
+ * when single window decorations are used */
+Window title_window(NoteWM_Frame* frame)
+{
+        return (frame->title_string_window != None) ? frame->title_string_window : frame->title_bar;
+}
+
+
+int title_width(NoteWM_Frame* frame)
+{
+        int width = frame->w;
+
+        if (frame->title_string_window != None)
+                width -= (PADDING * 2) + BUTTON_SIZE;
+        return (width > 0) ? width : 1;
+}
+
+
+int title_height(NoteWM_Frame* frame)
+{
+        return (frame->title_string_window != None) ? TITLE_WINDOW_HEIGHT : TITLE_HEIGHT;
+}
+
+
+/* draws the title into the frame's pixmap if the title or the width changed
+ * since it was last drawn. returns true if the pixmap was redrawn */
+bool render_frame_title(Display* display, NoteWM_Frame* frame)
+{
+        int width = title_width(frame);
+        int height = title_height(frame);
+        bool resized = (frame->title_pixmap == None || frame->title_pixmap_w != width);
+        int x = TITLE_STRING_X;
+        int y = TITLE_STRING_Y;
+        int max_width;
+
+        if (!resized && strcmp(frame->title, frame->info.name) == 0)
+                return false;
+
+        if (resized) {
+                if (frame->title_pixmap != None)
+                        XFreePixmap(display, frame->title_pixmap);
+                frame->title_pixmap = XCreatePixmap(
+                        display, frame->title_bar,
+                        width, height,
+                        DefaultDepth(display, DefaultScreen(display))
+                );
+                frame->title_pixmap_w = width;
+        }
+        strcpy(frame->title, frame->info.name);
+
+        /* without a title string window the text is offset by where that window would be */
+        if (frame->title_string_window == None) {
+                x += BORDER_WIDTH;
+                y += BORDER_WIDTH;
+        }
+
+        /* only send the characters that are visible, which in single window
+         * mode are the ones left of the buttons */
+        max_width = width - x;
+        if (frame->title_string_window == None && frame->button_list.count > 0)
+                max_width = frame->button_list.buttons[frame->button_list.count - 1].rect.x - PADDING - x;
+
+        XFillRectangle(display, frame->title_pixmap, frame->theme->gcs[GC_TITLE_BACKGROUND], 0, 0, width, height);
+        draw_text(display, frame->theme, frame->title_pixmap, x, y, frame->title, max_width);
+
+        if (frame->title_string_window == None)
+                draw_buttons(display, frame);
+        return true;
+}
+
+
+/* draws the buttons of a single window title bar into its pixmap */
+void draw_buttons(Display* display, NoteWM_Frame* frame)
+{
+        NoteWM_Button* button;
+        unsigned int i;
+
+        for (i = 0; i < frame->button_list.count; i++) {
+                button = &frame->button_list.buttons[i];
+                XCopyArea(
+                        display, frame->theme->buttons[button->style], frame->title_pixmap,
+                        frame->theme->gcs[GC_COPY],
+                        0, 0, button->rect.width, button->rect.height,
+                        button->rect.x, button->rect.y
+                );
+        }
+}
+
+
+/* returns the index of the button under (x, y) in title bar coordinates, or -1 */
+int find_button_at(NoteWM_Frame* frame, int x, int y)
+{
+        XRectangle* rect;
+        unsigned int i;
+
+        for (i = 0; i < frame->button_list.count; i++) {
+                rect = &frame->button_list.buttons[i].rect;
+                if (x >= rect->x && x < rect->x + rect->width
+                && y >= rect->y && y < rect->y + rect->height)
+                        return i;
+        }
+        return -1;
 }
 
 
+/* repaints the title bar if the client's name changed */
 void update_frame_text(Display* display, NoteWM_Frame* frame)
 {
-        char window_name[256];
-        get_window_name(display, frame->child_window, window_name, sizeof(window_name));
-        XClearWindow(display, frame->title_string_window);
+        refresh_frame_info(display, frame);
+
+        if (frame->title_string_window != None && title_width(frame) != frame->title_pixmap_w)
+                XResizeWindow(display, frame->title_string_window, title_width(frame), title_height(frame));
+
+        /* the copy is made even when the pixmap did not change, because
+         * expose_frame_title() left any exposed area to this paint pass */
+        render_frame_title(display, frame);
+        if (frame->title_pixmap != None) {
+                XCopyArea(
+                        display, frame->title_pixmap, title_window(frame), frame->theme->gcs[GC_COPY],
+                        0, 0, frame->title_pixmap_w, title_height(frame), 0, 0
+                );
+        }
+}
+
+
+/* repaints only the exposed part of the title from the pixmap */
+void expose_frame_title(Display* display, NoteWM_Frame* frame, XExposeEvent* e)
+{
+        /* a stale title is copied in whole by the next paint pass */
+        if (e->window != title_window(frame) || (frame->dirty & DIRTY_TITLE) || frame->title_pixmap == None)
+                return;
 
-        XDrawString(
-                display, frame->title_string_window, frame->gc,
-                TITLE_STRING_X, TITLE_STRING_Y,
-                window_name, strlen(window_name)
+        XCopyArea(
+                display, frame->title_pixmap, e->window, frame->theme->gcs[GC_COPY],
+                e->x, e->y, e->width, e->height, e->x, e->y
         );
 }
 
 
+/* ---------- Frame Painting ---------- */
+/* decorations are not drawn by event handlers, they mark what changed and
+ * paint_dirty_frames() draws each frame once after the whole batch of events
+ * has been handled */
+void mark_frame_dirty(NoteWM_Frame* frame, unsigned int dirty)
+{
+        if (!frame->dirty) {
+                frame->dirty_next = dirty_frames;
+                dirty_frames = frame;
+        }
+        frame->dirty |= dirty;
+}
+
+
+void unlink_dirty_frame(NoteWM_Frame* frame)
+{
+        NoteWM_Frame** link;
+
+        if (!frame->dirty)
+                return;
+
+        for (link = &dirty_frames; *link; link = &(*link)->dirty_next) {
+                if (*link == frame) {
+                        *link = frame->dirty_next;
+                        break;
+                }
+        }
+        frame->dirty = 0;
+        frame->dirty_next = NULL;
+}
+
+
+int button_x(NoteWM_Frame* frame, unsigned int index)
+{
+        return frame->w - (BUTTON_SIZE * (index + 1)) - (PADDING * (index + 1));
+}
+
+
+/* moves a frame over to the current theme. everything drawn with the old
+ * one has to be drawn again, so the title pixmap is thrown away */
+void apply_theme(Display* display, NoteWM_Frame* frame)
+{
+        release_theme(display, frame->theme);
+        frame->theme = acquire_theme(global_theme);
+
+        if (frame->title_pixmap != None) {
+                XFreePixmap(display, frame->title_pixmap);
+                frame->title_pixmap = None;
+        }
+}
+
+
+void paint_frame(Display* display, NoteWM_Frame* frame, unsigned int dirty)
+{
+        bool theme_changed = (frame->theme != global_theme);
+        unsigned int i;
+
+        if (theme_changed)
+                apply_theme(display, frame);
+
+        if (dirty & DIRTY_BORDER) {
+                XSetWindowBorder(display, frame->frame, global_state.conf.border_color);
+                XSetWindowBorder(display, frame->title_bar, global_state.conf.border_color);
+                XSetWindowBackground(display, frame->frame, global_state.conf.bg_color);
+                if (frame->title_string_window != None) {
+                        XSetWindowBackground(display, frame->title_bar, global_state.conf.title_bar_color);
+                        XClearWindow(display, frame->title_bar);
+                }
+        }
+
+        if (dirty & DIRTY_BUTTONS) {
+                for (i = 0; i < frame->button_list.count; i++) {
+                        NoteWM_Button* button = &frame->button_list.buttons[i];
+
+                        button->rect.x = button_x(frame, i);
+                        /* single window buttons are redrawn with the title, which
+                         * changes width whenever the buttons move */
+                        if (button->window == None)
+                                continue;
+
+                        XMoveWindow(display, button->window, button->rect.x, button->rect.y);
+                        if (theme_changed) {
+                                XSetWindowBackgroundPixmap(display, button->window, frame->theme->buttons[button->style]);
+                                XClearWindow(display, button->window);
+                        }
+                }
+        }
+
+        if (dirty & DIRTY_TITLE)
+                update_frame_text(display, frame);
+}
+
+
+/* ---------- Title Updates ---------- */
+/* clients can rename themselves many times a second, so a rename only sets
+ * title_pending. the title is redrawn at most title_rate times a second, and
+ * not at all while the frame is on a hidden workspace */
+void schedule_title_update(NoteWM_Frame* frame)
+{
+        if (frame->title_pending)
+                return;
+        frame->title_pending = true;
+        link_pending_title(frame);
+}
+
+
+void link_pending_title(NoteWM_Frame* frame)
+{
+        NoteWM_Frame** head = &pending_titles[frame->workspace_id];
+
+        frame->title_prev = NULL;
+        frame->title_next = *head;
+        if (*head)
+                (*head)->title_prev = frame;
+        *head = frame;
+}
+
+
+void unlink_pending_title(NoteWM_Frame* frame)
+{
+        if (frame->title_prev)
+                frame->title_prev->title_next = frame->title_next;
+        else
+                pending_titles[frame->workspace_id] = frame->title_next;
+
+        if (frame->title_next)
+                frame->title_next->title_prev = frame->title_prev;
+
+        frame->title_prev = NULL;
+        frame->title_next = NULL;
+}
+
+
+/* returns how many milliseconds until the frame's title may be redrawn */
+long title_wait(NoteWM_Frame* frame, unsigned long now)
+{
+        unsigned long interval;
+        unsigned long elapsed;
+
+        if (global_state.conf.title_rate == 0)
+                return 0;
+
+        interval = 1000 / global_state.conf.title_rate;
+        elapsed = now - frame->title_update_time;
+        return (elapsed >= interval) ? 0 : (long) (interval - elapsed);
+}
+
+
+/* marks the titles of visible frames dirty once their rate limit allows it */
+void flush_title_updates(void)
+{
+        NoteWM_Frame* frame;
+        NoteWM_Frame* next;
+        unsigned long now;
+
+        if (!pending_titles[global_state.current_workspace])
+                return;
+
+        now = get_time_ms();
+        for (frame = pending_titles[global_state.current_workspace]; frame; frame = next) {
+                next = frame->title_next;
+                if (title_wait(frame, now) > 0)
+                        continue;
+
+                unlink_pending_title(frame);
+                frame->title_pending = false;
+                frame->title_update_time = now;
+                mark_frame_dirty(frame, DIRTY_TITLE);
+        }
+}
+
+
+long title_update_timeout(void)
+{
+        NoteWM_Frame* frame;
+        unsigned long now;
+        long timeout = -1;
+        long wait;
+
+        if (!pending_titles[global_state.current_workspace])
+                return -1;
+
+        now = get_time_ms();
+        for (frame = pending_titles[global_state.current_workspace]; frame; frame = frame->title_next) {
+                wait = title_wait(frame, now);
+                if (timeout < 0 || wait < timeout)
+                        timeout = wait;
+        }
+        return timeout;
+}
+
+
+void paint_dirty_frames(Display* display)
+{
+        NoteWM_Frame* frame;
+        unsigned int dirty;
+
+        while ((frame = dirty_frames)) {
+                dirty_frames = frame->dirty_next;
+                dirty = frame->dirty;
+                frame->dirty = 0;
+                frame->dirty_next = NULL;
+                paint_frame(display, frame, dirty);
+        }
+}
+
+
 void set_frame_fullscreen(Display* display, NoteWM_Frame* frame, bool fullscreen)
 {
         if (fullscreen && !frame->is_fullscreen) {
-                XWindowAttributes attrs;
                 int screen_width;
                 int screen_height;
                 int x = 0;
@@ -239,12 +810,11 @@ void set_frame_fullscreen(Display* display, NoteWM_Frame* frame, bool fullscreen
                 int width;
                 int height;
 
-                XGetWindowAttributes(display, frame->frame, &attrs);
                 get_display_dimensions(display, &screen_width, &screen_height);
-                frame->x = attrs.x;
-                frame->y = attrs.y;
-                frame->w = attrs.width;
-                frame->h = attrs.height;
+                frame->restore_x = frame->x;
+                frame->restore_y = frame->y;
+                frame->restore_w = frame->w;
+                frame->restore_h = frame->h;
                 frame->is_fullscreen = true;
 
                 width = screen_width - (BORDER_WIDTH * 2);
@@ -254,68 +824,57 @@ void set_frame_fullscreen(Display* display, NoteWM_Frame* frame, bool fullscreen
                 XRaiseWindow(display, frame->frame);
         }
         else if (!fullscreen && frame->is_fullscreen) {
-                move_resize_frame(display, frame, frame->x, frame->y, frame->w, frame->h);
+                move_resize_frame(display, frame, frame->restore_x, frame->restore_y, frame->restore_w, frame->restore_h);
                 frame->is_fullscreen = false;
         }
 }
 
 /* ---------- Button Related Functions ---------- */
-void create_button(Display* display, NoteWM_Frame* frame, unsigned long color, unsigned long mask, ButtonClickFunc event_function)
+void init_button(NoteWM_Frame* frame, unsigned int index, NoteWM_Button* button)
 {
-        XWindowAttributes attrs;
-        NoteWM_Button new_button;
-        int index;
-        int x;
-        int y;
-
-        if (!frame->button_list)
-                frame->button_list = init_button_list(4);
-
-        XGetWindowAttributes(display, frame->title_bar, &attrs);
-
-        index = frame->button_list->count + 1;
-        x = attrs.width - (BUTTON_SIZE * index) - (PADDING * index);
-        y = TITLE_HEIGHT - BUTTON_SIZE - PADDING;
-
-        new_button.window = XCreateSimpleWindow(
-                display, frame->title_bar,
-                x, y,
-                BUTTON_SIZE, BUTTON_SIZE,
-                1, global_state.conf.button_border_color, color
-        );
-
-        new_button.on_click = event_function;
-
-        XSelectInput(display, new_button.window, mask);
-        append_button(frame->button_list, new_button);
-        XMapWindow(display, new_button.window);
+        /* the rectangle includes the one pixel border */
+        button->rect.x = button_x(frame, index);
+        button->rect.y = TITLE_HEIGHT - BUTTON_SIZE - PADDING;
+        button->rect.width = BUTTON_SIZE + 2;
+        button->rect.height = BUTTON_SIZE + 2;
+        button->window = None;
 }
 
 
-NoteWM_ButtonList* init_button_list(unsigned int initial_capacity)
+void create_button(Display* display, NoteWM_Frame* frame, NoteWM_ButtonStyle style, unsigned long mask, ButtonClickFunc event_function)
 {
-        NoteWM_ButtonList* button_list = malloc(sizeof(NoteWM_ButtonList));
-        button_list->buttons = malloc(sizeof(NoteWM_Button) * initial_capacity);
-        button_list->count = 0;
-        button_list->capacity = initial_capacity;
-        return button_list;
-}
+        NoteWM_Button new_button;
+        int index;
 
+        if (frame->button_list.count >= NUM_TITLE_BUTTONS)
+                return;
 
-void append_button(NoteWM_ButtonList* button_list, NoteWM_Button button)
-{
-        if (button_list->count >= button_list->capacity) {
-                button_list->capacity *= 2;
-                button_list->buttons = realloc(button_list->buttons, sizeof(NoteWM_Button) * button_list->capacity);
+        index = frame->button_list.count;
+        init_button(frame, index, &new_button);
+        new_button.style = style;
+        new_button.on_click = event_function;
+
+        if (frame->title_string_window != None) {
+                /* the theme's button pixmap already has the border drawn in */
+                new_button.window = XCreateSimpleWindow(
+                        display, frame->title_bar,
+                        new_button.rect.x, new_button.rect.y,
+                        new_button.rect.width, new_button.rect.height,
+                        0, 0, 0
+                );
+                XSetWindowBackgroundPixmap(display, new_button.window, frame->theme->buttons[style]);
+                XSelectInput(display, new_button.window, mask);
+                XMapWindow(display, new_button.window);
         }
 
-        button_list->buttons[button_list->count++] = button;
+        append_button(&frame->button_list, new_button);
 }
 
 
-void free_button_list(NoteWM_ButtonList* button_list)
+/* buttons live in the frame itself, so there are at most NUM_TITLE_BUTTONS */
+void append_button(NoteWM_ButtonList* button_list, NoteWM_Button button)
 {
-        free(button_list->buttons);
-        free(button_list);
+        if (button_list->count < NUM_TITLE_BUTTONS)
+                button_list->buttons[button_list->count++] = button;
 }
 
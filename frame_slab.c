@@ -0,0 +1,71 @@
+/*
+ * file: frame_slab.c
+ * ------------------
+ * This file contains the allocator for NoteWM_Frame. Frames are carved out of
+ * slabs of FRAMES_PER_SLAB frames and freed frames are kept on a free list
+ * for the next client, so short lived windows such as popups and dialogs
+ * never go through malloc and free, and frames that were created together
+ * stay next to each other in memory.
+ *
+ * Slabs are only freed when NoteWM exits.
+ *
+ * Author: Mason Armand
+ * Date Created: Jun 1, 2023
+ * Last Modified: Jun 8, 2023
+ */
+#include "notewm.h"
+
+void grow_frame_slabs(void);
+
+static NoteWM_FrameSlab* frame_slabs = NULL;
+/* free frames, linked through their next pointer */
+static NoteWM_Frame* free_frames = NULL;
+
+
+void grow_frame_slabs(void)
+{
+        NoteWM_FrameSlab* slab = malloc(sizeof(NoteWM_FrameSlab));
+        int i;
+
+        slab->next = frame_slabs;
+        frame_slabs = slab;
+
+        /* pushed in reverse so frames are handed out in address order */
+        for (i = FRAMES_PER_SLAB - 1; i >= 0; i--) {
+                slab->frames[i].next = free_frames;
+                free_frames = &slab->frames[i];
+        }
+}
+
+
+/* returns an uninitialised frame */
+NoteWM_Frame* alloc_frame(void)
+{
+        NoteWM_Frame* frame;
+
+        if (!free_frames)
+                grow_frame_slabs();
+
+        frame = free_frames;
+        free_frames = frame->next;
+        return frame;
+}
+
+
+void dealloc_frame(NoteWM_Frame* frame)
+{
+        frame->next = free_frames;
+        free_frames = frame;
+}
+
+
+void free_frame_slabs(void)
+{
+        NoteWM_FrameSlab* slab;
+
+        while ((slab = frame_slabs)) {
+                frame_slabs = slab->next;
+                free(slab);
+        }
+        free_frames = NULL;
+}
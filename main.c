@@ -14,13 +14,166 @@ Cursor global_cursor_default;
 Cursor global_cursor_resize;
 Cursor global_cursor_grab;
 Cursor global_cursor_plus;
-XFontStruct* global_font;
 
-int main(void)
+bool wait_for_event(Display* display, int child_fd, long timeout_ms);
+bool handle_event(Display* display, Window root, XEvent* e, NoteWM_Frame** list, NoteWM_WindowResizeInfo* r_info);
+long next_timeout(NoteWM_WindowResizeInfo* r_info);
+
+
+/* waits until the X connection has events to read or timeout_ms has passed,
+ * a negative timeout waits forever. exited children are reaped while waiting.
+ * returns false if there are no X events to read */
+bool wait_for_event(Display* display, int child_fd, long timeout_ms)
+{
+        int fd = ConnectionNumber(display);
+        int max_fd = (child_fd > fd) ? child_fd : fd;
+        struct timeval tv;
+        fd_set fds;
+
+        if (XPending(display))
+                return true;
+
+        FD_ZERO(&fds);
+        FD_SET(fd, &fds);
+        if (child_fd >= 0)
+                FD_SET(child_fd, &fds);
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+        if (select(max_fd + 1, &fds, NULL, NULL, (timeout_ms < 0) ? NULL : &tv) <= 0)
+                return false;
+
+        if (child_fd >= 0 && FD_ISSET(child_fd, &fds))
+                reap_children(child_fd);
+
+        return FD_ISSET(fd, &fds);
+}
+
+
+/* returns how long the main loop may sleep before a rate limited drag update
+ * or title redraw is due, or -1 if nothing is waiting */
+long next_timeout(NoteWM_WindowResizeInfo* r_info)
+{
+        long motion = pending_motion_timeout(r_info);
+        long title = title_update_timeout();
+
+        if (motion < 0)
+                return title;
+        if (title < 0)
+                return motion;
+        return (motion < title) ? motion : title;
+}
+
+
+/* dispatches a single event to its handler. returns false when NoteWM should exit */
+bool handle_event(Display* display, Window root, XEvent* e, NoteWM_Frame** list, NoteWM_WindowResizeInfo* r_info)
+{
+        NoteWM_Frame* frame;
+        NoteWM_Component component;
+        XKeyEvent k;
+        bool running = true;
+
+        switch (e->type) {
+        case MapRequest:
+                handle_map_request(display, root, &e->xmaprequest, list);
+                break;
+        case UnmapNotify:
+                handle_unmap_notify(display, root, &e->xunmap);
+                break;
+        case DestroyNotify:
+                handle_destroy_notify(display, &e->xdestroywindow, list);
+                break;
+        case ConfigureRequest:
+                handle_configure_request(display, &e->xconfigurerequest);
+                break;
+        case PropertyNotify:
+                handle_property_notify(display, &e->xproperty);
+                break;
+        case ClientMessage:
+                handle_client_message(display, root, &e->xclient, list);
+                break;
+        case ReparentNotify:
+                handle_reparent_notify(display, root, &e->xreparent, list);
+                break;
+        case CreateNotify:
+                handle_create_notify(display, root, &e->xcreatewindow);
+                break;
+        case ConfigureNotify:
+                handle_configure_notify(display, &e->xconfigure);
+                break;
+        case ResizeRequest:
+                handle_resize_request(display, &e->xresizerequest);
+                break;
+        case ButtonPress:
+                handle_button_press(display, root, &e->xbutton, list);
+                r_info->event = e->xbutton;
+                r_info->pending = false;
+                if ((frame = find_frame_by_component(e->xbutton.subwindow, NULL))) {
+                        r_info->x = frame->x;
+                        r_info->y = frame->y;
+                        r_info->w = frame->w;
+                        r_info->h = frame->h;
+                }
+                break;
+        case ButtonRelease:
+                /* always commit the final position of a drag */
+                apply_pending_motion(display, r_info, true);
+                XUngrabPointer(display, CurrentTime);
+                r_info->event.subwindow = None;
+                break;
+        case MotionNotify:
+                /* skip to the newest of consecutive queued motion events */
+                while (XEventsQueued(display, QueuedAfterReading)) {
+                        XEvent next;
+                        XPeekEvent(display, &next);
+                        if (next.type != MotionNotify)
+                                break;
+                        XNextEvent(display, e);
+                }
+                handle_motion_notify(display, &e->xmotion, r_info);
+                break;
+        case EnterNotify:
+                handle_enter_notify(display, root, &e->xcrossing);
+                break;
+        case KeyPress:
+                k = e->xkey;
+                handle_key_press(display, root, &e->xkey);
+
+                if ((k.state & Mod4Mask) && (k.state & ShiftMask) && k.keycode == XKeysymToKeycode(display, XK_E))
+                        running = false;
+
+                if ((k.state & Mod4Mask) && (k.state & ShiftMask) && k.keycode == XKeysymToKeycode(display, XK_C))
+                        reload_theme(display, root);
+
+                if ((k.state & Mod4Mask) && (k.state & ShiftMask) && k.keycode == XKeysymToKeycode(display, XK_R)) {
+                        global_state.restart = true;
+                        running = false;
+                }
+
+                if ((k.state & Mod4Mask) && k.keycode == XKeysymToKeycode(display, XK_d)) {
+                        launch_program(global_state.conf.launcher_command);
+                }
+                if ((k.state & Mod4Mask) && k.keycode == XKeysymToKeycode(display, XK_Return)) {
+                        launch_program(global_state.conf.terminal_command);
+                }
+                break;
+        case Expose:
+                frame = find_frame_by_component(e->xexpose.window, &component);
+                if (frame && (component == COMPONENT_TITLE_STRING || component == COMPONENT_TITLE_BAR))
+                        expose_frame_title(display, frame, &e->xexpose);
+                break;
+        }
+
+        return running;
+}
+
+
+int main(int argc, char** argv)
 {
         Display* display;
         Window root;
         XEvent e;
+        int child_fd;
         bool running = true;
 
         /* GrabKeys */
@@ -29,6 +182,8 @@ int main(void)
                 { XK_Return, Mod4Mask },
                 { XK_q, Mod4Mask },
                 { XK_E, Mod4Mask | ShiftMask},
+                { XK_C, Mod4Mask | ShiftMask},
+                { XK_R, Mod4Mask | ShiftMask},
                 /* for switching workspaces */
                 { XK_1, Mod4Mask },
                 { XK_2, Mod4Mask },
@@ -52,19 +207,8 @@ int main(void)
         NoteWM_Frame* client_list = NULL;
         NoteWM_WindowResizeInfo r_info = { 0 };
 
-        /* default colors */
-        global_state.conf.title_bar_color = 0xeaffff;
-        global_state.conf.button_border_color = 0x000000;
-        global_state.conf.border_color = 0x55aaaa;
-        global_state.conf.fg_color = 0x000000;
-        global_state.conf.bg_color = 0xffffea;
-        global_state.conf.close_color = 0xffaaaa;
-        global_state.conf.expand_color = 0xeeee9e;
-        global_state.conf.split_color = 0x88cc88;
-
-        if (ini_parse("/home/mace/.config/notewm/config.ini", conf_handler, &global_state.conf) < 0) {
-                fprintf(stderr, "Failed to load config.ini, using default settings.\n");
-        }
+        (void) argc;
+        load_config(&global_state.conf);
 
         XSetErrorHandler(xerror_handler);
 
@@ -72,25 +216,23 @@ int main(void)
                 fprintf(stderr, "Failed to open display.\n");
 
         root = DefaultRootWindow(display);
+        init_atoms(display);
+        child_fd = init_spawn(display);
 
+        /* pointer events only arrive through button grabs, and motion only
+         * while grab_change_cursor holds the pointer for a move or resize,
+         * so an idle pointer never wakes us up */
         XSelectInput(
                 display, root,
                 SubstructureRedirectMask |
-                SubstructureNotifyMask |
-                PropertyChangeMask |
-                ButtonPressMask |
-                ButtonReleaseMask |
-                PointerMotionMask
+                SubstructureNotifyMask
         );
 
         /*XSynchronize(display, true);*/
         global_state.current_workspace = 0;
 
-        global_font = XLoadQueryFont(display, "-misc-fixed-bold-r-normal--13-120-75-75-C-70-iso10646-1");
-        if (!global_font) {
-                fprintf(stderr, "Failed to load font\n");
+        if (!(global_theme = create_theme(display, root)))
                 return 1;
-        }
 
         /* define cursors */
         global_cursor_default = XCreateFontCursor(display, XC_left_ptr);
@@ -102,6 +244,9 @@ int main(void)
         grab_keys(display, root, keybindings);
         grab_buttons(display, root, mousebindings);
 
+        /* clients framed before a restart are framed again first, so that
+         * adopting does not frame them a second time */
+        restore_state(display, root, &client_list);
         adopt_existing_windows(display, root, &client_list);
         set_net_supported(display, root);
         set_ewhm_desktop_properties(display, root);
@@ -109,85 +254,46 @@ int main(void)
         XMapRaised(display, root);
 
         while (running) {
-                NoteWM_Frame* frame;
-                XKeyEvent k;
-
-                XNextEvent(display, &e);
-
-                switch (e.type) {
-                case MapRequest:
-                        handle_map_request(display, root, &e.xmaprequest, &client_list);
-                        break;
-                case UnmapNotify:
-                        handle_unmap_notify(display, root, &e.xunmap, &client_list);
-                        break;
-                case DestroyNotify:
-                        handle_destroy_notify(display, root, &e.xdestroywindow, &client_list);
-                        XSetInputFocus(display, root, RevertToPointerRoot, CurrentTime);
-                        XSync(display, false);
-                        break;
-                case ConfigureRequest:
-                        handle_configure_request(display, &e.xconfigurerequest, client_list);
-                        break;
-                case PropertyNotify:
-                        handle_property_notify(display, &e.xproperty, client_list);
-                        break;
-                case ClientMessage:
-                        handle_client_message(display, root, &e.xclient, &client_list);
-                        break;
-                case ReparentNotify:
-                        handle_reparent_notify(display, root, &e.xreparent, &client_list);
-                        break;
-                case ResizeRequest:
-                        handle_resize_request(display, &e.xresizerequest, client_list);
-                        break;
-                case ButtonPress:
-                        handle_button_press(display, root, &e.xbutton, &client_list);
-                        r_info.event = e.xbutton;
-                        if (e.xbutton.subwindow != None)
-                                XGetWindowAttributes(display, e.xbutton.subwindow, &r_info.attrs);
-                        break;
-                case ButtonRelease:
-                        XUngrabPointer(display, CurrentTime);
-                        r_info.event.subwindow = None;
-                        break;
-                case MotionNotify:
-                        handle_motion_notify(display, &e.xbutton, r_info, client_list);
-                        break;
-                case EnterNotify:
-                        handle_enter_notify(display, root, &e.xcrossing, client_list);
-                        break;
-                case KeyPress:
-                        k = e.xkey;
-                        handle_key_press(display, root, &e.xkey, client_list);
-
-                        if ((k.state & Mod4Mask) && (k.state & ShiftMask) && k.keycode == XKeysymToKeycode(display, XK_E))
-                                running = false;
-
-                        if ((k.state & Mod4Mask) && k.keycode == XKeysymToKeycode(display, XK_d)) {
-                                system("dmenu_run -fn 'Droid Sans Mono-12' -nb black -sb '#ffffff' -l 5");
-                        }
-                        if ((k.state & Mod4Mask) && k.keycode == XKeysymToKeycode(display, XK_Return)) {
-                                launch_program("xfce4-terminal");
-                        }
-                        break;
-                case Expose:
-                        if (e.xexpose.count == 0) {
-                                frame = find_frame_by_component(e.xexpose.window, client_list);
-                                if (frame) {
-                                        update_frame_text(display, frame);
-                                }
-                        }
-                        break;
+                /* spare decorations are only built when there is nothing else to do */
+                if (!XPending(display))
+                        refill_decoration_pool(display, root);
+
+                if (!wait_for_event(display, child_fd, next_timeout(&r_info))) {
+                        apply_pending_motion(display, &r_info, false);
+                        run_deferred_work(display, root);
+                        XFlush(display);
+                        continue;
+                }
+
+                /* handle every event that has already arrived before doing the
+                 * deferred work, so that it runs once per batch instead of per event */
+                while (running && XEventsQueued(display, QueuedAfterReading)) {
+                        XNextEvent(display, &e);
+                        running = handle_event(display, root, &e, &client_list, &r_info);
                 }
+
+                apply_pending_motion(display, &r_info, false);
+                run_deferred_work(display, root);
+                XFlush(display);
         }
+        drain_decoration_pool(display);
+        if (global_state.restart)
+                save_state(display, root, client_list);
         free_client_window_list();
-        XFreeFont(display, global_font);
+        free_window_index();
+        free_frame_slabs();
+        if (global_theme->glyphs)
+                print_glyph_cache_stats(global_theme->glyphs);
+        release_theme(display, global_theme);
         XFreeCursor(display, global_cursor_default);
         XFreeCursor(display, global_cursor_resize);
         XFreeCursor(display, global_cursor_grab);
         XFreeCursor(display, global_cursor_plus);
         XCloseDisplay(display);
+        if (child_fd >= 0)
+                close(child_fd);
 
+        if (global_state.restart)
+                return restart_notewm(argv);
         return 0;
 }
@@ -12,10 +12,17 @@
 #ifndef NOTEWM_H
 #define NOTEWM_H
 
+/* needed for the POSIX clock and select functions, since we build with -std=c89 */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <X11/Xlib.h>
+#include <X11/Xlib-xcb.h>
 #include <X11/Xatom.h>
 #include <X11/Xutil.h>
 #include <X11/cursorfont.h>
+#include <X11/extensions/Xrender.h>
 #include <X11/keysymdef.h>
 #include <X11/keysym.h>
 #include <stdio.h>
@@ -24,9 +31,20 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <string.h>
+#include <time.h>
+#include <sys/select.h>
 #include "ini.h"
 /* ---------- Macros ---------- */
 #define NUM_WORKSPACES 9
+#define MAX_WINDOW_TYPES 8
+#define MAX_WINDOW_STATES 8
+#define MAX_TITLE_LENGTH 256
+#define MAX_RES_NAME_LENGTH 64
+#define NUM_TITLE_BUTTONS 4
+#define FRAMES_PER_SLAB 32
+/* a title can never need more glyphs than the cache holds */
+#define GLYPH_CACHE_SIZE 512
+#define GLYPH_HASH_SIZE 1024
 
 /* sizing */
 #define BORDER_WIDTH 2
@@ -35,36 +53,53 @@
 #define PADDING 4
 #define TITLE_STRING_X 10
 #define TITLE_STRING_Y (TITLE_HEIGHT / 2) + 2
-
-/* cursed atom macros, should probably change this later */
-#define _NET_WM_WINDOW_TYPE (XInternAtom(display, "_NET_WM_WINDOW_TYPE", false))
-#define _NET_WM_WINDOW_TYPE_NORMAL (XInternAtom(display, "_NET_WM_WINDOW_TYPE_NORMAL", false))
-#define _NET_WM_WINDOW_TYPE_DOCK (XInternAtom(display, "_NET_WM_WINDOW_TYPE_DOCK", false))
-#define _NET_WM_WINDOW_TYPE_TOOLBAR (XInternAtom(display, "_NET_WM_WINDOW_TYPE_TOOLBAR", false))
-#define _NET_WM_WINDOW_TYPE_UTILITY (XInternAtom(display, "_NET_WM_WINDOW_TYPE_UTILITY", false))
-#define _NET_WM_WINDOW_TYPE_MENU (XInternAtom(display, "_NET_WM_WINDOW_TYPE_MENU", false))
-#define _NET_WM_WINDOW_TYPE_DIALOG (XInternAtom(display, "_NET_WM_WINDOW_TYPE_DIALOG", false))
-#define _NET_WM_WINDOW_TYPE_DROPDOWN_MENU (XInternAtom(display, "_NET_WM_WINDOW_TYPE_DROPDOWN_MENU", false))
-#define _NET_WM_WINDOW_TYPE_POPUP_MENU (XInternAtom(display, "_NET_WM_WINDOW_TYPE_POPUP_MENU", false))
-#define _NET_WM_WINDOW_TYPE_TOOLTIP (XInternAtom(display, "_NET_WM_WINDOW_TYPE_TOOLTIP", false))
-#define _NET_WM_WINDOW_TYPE_NOTIFICATION (XInternAtom(display, "_NET_WM_WINDOW_TYPE_NOTIFICATION", false))
-#define _NET_WM_WINDOW_TYPE_COMBO (XInternAtom(display, "_NET_WM_WINDOW_TYPE_COMBO", false))
-#define _NET_WM_WINDOW_TYPE_DND (XInternAtom(display, "_NET_WM_WINDOW_TYPE_DND", false))
-#define _NET_WM_WINDOW_TYPE_DESKTOP (XInternAtom(display, "_NET_WM_WINDOW_TYPE_DESKTOP", false))
-/* state atoms */
-#define _NET_WM_STATE (XInternAtom(display, "_NET_WM_STATE", false))
-#define _NET_WM_STATE_MODAL (XInternAtom(display, "_NET_WM_STATE_MODAL", false))
-#define _NET_WM_STATE_HIDDEN (XInternAtom(display, "_NET_WM_STATE_MODAL", false))
-#define _NET_WM_STATE_ABOVE (XInternAtom(display, "_NET_WM_STATE_MODAL", false))
-#define _NET_WM_STATE_FULLSCREEN (XInternAtom(display, "_NET_WM_STATE_FULLSCREEN", false))
-/* other atoms */
-#define WM_PROTOCOLS (XInternAtom(display, "WM_PROTOCOLS", false))
-#define WM_DELETE_WINDOW (XInternAtom(display, "WM_DELETE_WINDOW", false))
-#define _NET_CLOSE_WINDOW (XInternAtom(display, "_NET_CLOSE_WINDOW", false))
-
+/* offset of the client window inside its frame, below the title bar and its border */
+#define CLIENT_OFFSET_Y (TITLE_HEIGHT + BORDER_WIDTH)
 
 /* ---------- NoteWM Data Structures ---------- */
 
+/* indices into global_atoms, which is interned in one batch by init_atoms().
+ * keep in the same order as the names in window_manager.c */
+enum {
+        /* window type atoms */
+        ATOM_NET_WM_WINDOW_TYPE,
+        ATOM_NET_WM_WINDOW_TYPE_NORMAL,
+        ATOM_NET_WM_WINDOW_TYPE_DOCK,
+        ATOM_NET_WM_WINDOW_TYPE_TOOLBAR,
+        ATOM_NET_WM_WINDOW_TYPE_UTILITY,
+        ATOM_NET_WM_WINDOW_TYPE_MENU,
+        ATOM_NET_WM_WINDOW_TYPE_DIALOG,
+        ATOM_NET_WM_WINDOW_TYPE_DROPDOWN_MENU,
+        ATOM_NET_WM_WINDOW_TYPE_POPUP_MENU,
+        ATOM_NET_WM_WINDOW_TYPE_TOOLTIP,
+        ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION,
+        ATOM_NET_WM_WINDOW_TYPE_COMBO,
+        ATOM_NET_WM_WINDOW_TYPE_DND,
+        ATOM_NET_WM_WINDOW_TYPE_DESKTOP,
+        /* state atoms */
+        ATOM_NET_WM_STATE,
+        ATOM_NET_WM_STATE_MODAL,
+        ATOM_NET_WM_STATE_HIDDEN,
+        ATOM_NET_WM_STATE_ABOVE,
+        ATOM_NET_WM_STATE_FULLSCREEN,
+        /* desktop atoms */
+        ATOM_NET_SUPPORTED,
+        ATOM_NET_CLIENT_LIST,
+        ATOM_NET_NUMBER_OF_DESKTOPS,
+        ATOM_NET_CURRENT_DESKTOP,
+        ATOM_NET_DESKTOP_NAMES,
+        ATOM_NET_DESKTOP_VIEWPORT,
+        ATOM_NET_WM_DESKTOP,
+        /* other atoms */
+        ATOM_NET_WM_NAME,
+        ATOM_UTF8_STRING,
+        ATOM_NET_CLOSE_WINDOW,
+        ATOM_WM_PROTOCOLS,
+        ATOM_WM_DELETE_WINDOW,
+        ATOM_NOTEWM_STATE,
+        ATOM_COUNT
+};
+
 typedef struct NoteWM_Frame NoteWM_Frame;
 
 typedef void (*ButtonClickFunc)(Display* display, Window root, NoteWM_Frame* frame, NoteWM_Frame** list);
@@ -78,44 +113,283 @@ typedef struct {
         unsigned long expand_color;
         unsigned long split_color;
         unsigned long button_border_color;
+        unsigned int drag_rate; /* max interactive move/resize updates per second, 0 for no limit */
+        unsigned int title_rate; /* max title redraws per second for each client, 0 for no limit */
+        unsigned int decoration_pool_size; /* spare decoration trees kept for new clients, 0 for none */
+        bool single_window_decorations; /* draw the title and buttons into the title bar window */
+        char launcher_command[256];
+        char terminal_command[256];
+        char font[256]; /* XLFD pattern for the title font, empty for the default */
 } NoteWM_Config;
 
 typedef struct {
         unsigned int current_workspace;
+        NoteWM_Frame* workspaces[NUM_WORKSPACES]; /* frames on each workspace */
+        /* managed clients in _NET_CLIENT_LIST order, client_frames[i] is the
+         * frame of client_windows[i] and has client_index i */
         unsigned int num_client_windows;
+        unsigned int client_capacity;
         Window* client_windows;
+        NoteWM_Frame** client_frames;
+        bool client_list_dirty; /* _NET_CLIENT_LIST is written by run_deferred_work() */
         NoteWM_Config conf;
+        /* crossing events up to this request serial were caused by our own
+         * mapping, unmapping, restacking and resizing */
+        unsigned long ignore_crossing_serial;
+        /* work deferred until the current batch of events has been handled */
+        bool revert_focus;
+        bool restart; /* exec a new NoteWM that takes over the frames once the main loop exits */
 } NoteWM_GlobalState;
 
+/* GCs shared by all frames, one for each thing that is drawn */
+enum {
+        GC_TITLE_TEXT,       /* title text, with the font set */
+        GC_TITLE_BACKGROUND, /* fills with the title bar color */
+        GC_COPY,             /* copying pixmaps to windows */
+        GC_COUNT
+};
+
+typedef enum {
+        BUTTON_CLOSE,
+        BUTTON_EXPAND,
+        BUTTON_SPLIT,
+        BUTTON_STYLE_COUNT
+} NoteWM_ButtonStyle;
+
 typedef struct {
-        Window window;
+        unsigned long codepoint;
+        int advance;
+        int prev, next; /* least recently used list, most recent first */
+        int hash_next;
+} NoteWM_CachedGlyph;
+
+/* glyphs uploaded to the server, indexed by codepoint. the index of a glyph
+ * in glyphs is also its id in the glyph set */
+typedef struct {
+        GlyphSet glyphset;
+        XRenderPictFormat* glyph_format;
+        XRenderPictFormat* target_format;
+        Picture fill; /* title text color */
+        Pixmap bitmap;
+        GC bitmap_gc;
+        NoteWM_CachedGlyph glyphs[GLYPH_CACHE_SIZE];
+        int hash[GLYPH_HASH_SIZE];
+        int lru_head, lru_tail;
+        unsigned int count;
+        unsigned long hits, misses, evictions;
+} NoteWM_GlyphCache;
+
+/* decoration resources shared by every frame drawn with them */
+typedef struct {
+        unsigned int refcount;
+        Font font;
+        int ascent, descent;
+        int fixed_width; /* width of every glyph, or 0 if the font is not monospaced */
+        int max_advance; /* width of the widest glyph */
+        short widths[256]; /* widths of the glyphs looked up so far, -1 if not yet */
+        NoteWM_GlyphCache* glyphs; /* NULL if the server has no RENDER extension */
+        GC gcs[GC_COUNT];
+        Pixmap buttons[BUTTON_STYLE_COUNT]; /* each button with its border drawn in */
+} NoteWM_Theme;
+
+typedef struct {
+        Window window; /* None when the button is drawn into the title bar */
+        XRectangle rect; /* position in the title bar, including the border */
+        NoteWM_ButtonStyle style;
         ButtonClickFunc on_click;
 } NoteWM_Button;
 
+/* stored inline in the frame, every frame has the same NUM_TITLE_BUTTONS buttons */
 typedef struct {
-        NoteWM_Button* buttons;
+        NoteWM_Button buttons[NUM_TITLE_BUTTONS];
         unsigned int count;
-        unsigned int capacity;
 } NoteWM_ButtonList;
 
+/* parts of a frame's decorations that need to be painted again, used as a bitmask */
+enum {
+        DIRTY_TITLE   = 1 << 0,
+        DIRTY_BUTTONS = 1 << 1,
+        DIRTY_BORDER  = 1 << 2
+};
+
+/* client properties cached in NoteWM_ClientInfo, used as a bitmask */
+enum {
+        PROPERTY_WINDOW_TYPE  = 1 << 0, /* _NET_WM_WINDOW_TYPE */
+        PROPERTY_STATE        = 1 << 1, /* _NET_WM_STATE */
+        PROPERTY_NORMAL_HINTS = 1 << 2, /* WM_NORMAL_HINTS */
+        PROPERTY_PROTOCOLS    = 1 << 3, /* WM_PROTOCOLS */
+        PROPERTY_CLASS        = 1 << 4, /* WM_CLASS */
+        PROPERTY_NAME         = 1 << 5, /* _NET_WM_NAME and WM_NAME */
+        PROPERTY_DESKTOP      = 1 << 6, /* _NET_WM_DESKTOP */
+        PROPERTY_ALL          = (1 << 7) - 1
+};
+
+/* outstanding requests for everything needed to manage a client */
+typedef struct {
+        Window window;
+        xcb_get_window_attributes_cookie_t attributes;
+        xcb_get_geometry_cookie_t geometry;
+        xcb_query_tree_cookie_t tree;
+        xcb_get_property_cookie_t window_type;
+        xcb_get_property_cookie_t state;
+        xcb_get_property_cookie_t normal_hints;
+        xcb_get_property_cookie_t protocols;
+        xcb_get_property_cookie_t wm_class;
+        xcb_get_property_cookie_t net_wm_name;
+        xcb_get_property_cookie_t wm_name;
+        xcb_get_property_cookie_t desktop;
+} NoteWM_ClientQuery;
+
+/* the replies to a NoteWM_ClientQuery */
+typedef struct {
+        Window window;
+        bool valid; /* false if the window was gone before the replies arrived */
+        bool override_redirect;
+        int map_state;
+        int x, y, width, height;
+        Window parent;
+        Atom window_types[MAX_WINDOW_TYPES];
+        unsigned int num_window_types;
+        Atom states[MAX_WINDOW_STATES];
+        unsigned int num_states;
+        bool has_size_hint; /* PSize was set in WM_NORMAL_HINTS */
+        int hint_width, hint_height;
+        bool supports_delete_window; /* WM_DELETE_WINDOW is in WM_PROTOCOLS */
+        char res_name[MAX_RES_NAME_LENGTH];  /* WM_CLASS */
+        char res_class[MAX_RES_NAME_LENGTH];
+        char name[MAX_TITLE_LENGTH]; /* _NET_WM_NAME or WM_NAME, converted to UTF-8 */
+        long desktop; /* _NET_WM_DESKTOP, -1 if it is not set */
+} NoteWM_ClientInfo;
+
 struct NoteWM_Frame {
+        /* fields read while walking the frame lists and handling events come
+         * first so they share the first few cache lines */
+        struct NoteWM_Frame* next; /* also links free frames in their slab */
+        /* links in the list of frames on the same workspace */
+        struct NoteWM_Frame* ws_prev;
+        struct NoteWM_Frame* ws_next;
         Window frame;
         Window title_bar;
         Window title_string_window;
-        NoteWM_ButtonList* button_list;
         Window child_window;
-        GC gc;
         unsigned short workspace_id;
-        int x, y, w, h;
+        bool is_mapped;
         bool is_fullscreen;
+        bool child_mapped;
         bool ignore_configure_events;
+        bool child_released; /* the client was destroyed or reparented out of the frame */
+        int x, y, w, h;                 /* frame geometry, kept in sync with every move/resize */
+        int client_w, client_h;         /* client size, the client sits at (0, CLIENT_OFFSET_Y) */
+        unsigned long geometry_serial;  /* last request that changed the geometry */
+        /* UnmapNotify events on the frame and on the client caused by our own requests */
+        unsigned int ignore_unmap;
+        unsigned int ignore_child_unmap;
+        unsigned int client_index; /* position in global_state.client_windows */
+        /* decorations waiting for paint_dirty_frames() */
+        unsigned int dirty;
+        struct NoteWM_Frame* dirty_next;
+        NoteWM_Theme* theme; /* the theme the decorations were last painted with */
+        NoteWM_ButtonList button_list;
+
+        int restore_x, restore_y, restore_w, restore_h; /* geometry from before fullscreen */
+        /* the client renamed itself since the title was last redrawn, pending
+         * frames on the same workspace are linked through title_next */
+        bool title_pending;
+        struct NoteWM_Frame* title_prev;
+        struct NoteWM_Frame* title_next;
+        unsigned long title_update_time;
+        /* the title as it was last drawn into title_pixmap, which Expose copies from */
+        Pixmap title_pixmap;
+        int title_pixmap_w;
+        char title[MAX_TITLE_LENGTH];
+        /* properties of the client, re-read by refresh_frame_info() once they are stale */
+        unsigned int stale_properties;
+        NoteWM_ClientInfo info;
+};
+
+/* frames are allocated from slabs of FRAMES_PER_SLAB that are never freed or
+ * moved, so a frame pointer stays valid as a handle for as long as it is in use */
+typedef struct NoteWM_FrameSlab {
+        struct NoteWM_FrameSlab* next;
+        NoteWM_Frame frames[FRAMES_PER_SLAB];
+} NoteWM_FrameSlab;
+
+/* layout of the client info save_client_info() writes into a frame's record.
+ * strings are packed four bytes to an element */
+enum {
+        INFO_NUM_WINDOW_TYPES,
+        INFO_WINDOW_TYPES,
+        INFO_NUM_STATES = INFO_WINDOW_TYPES + MAX_WINDOW_TYPES,
+        INFO_STATES,
+        INFO_FLAGS = INFO_STATES + MAX_WINDOW_STATES,
+        INFO_HINT_WIDTH,
+        INFO_HINT_HEIGHT,
+        INFO_DESKTOP,
+        INFO_RES_NAME,
+        INFO_RES_CLASS = INFO_RES_NAME + MAX_RES_NAME_LENGTH / 4,
+        INFO_NAME = INFO_RES_CLASS + MAX_RES_NAME_LENGTH / 4,
+        INFO_SIZE = INFO_NAME + MAX_TITLE_LENGTH / 4
+};
 
-        struct NoteWM_Frame* next;
+/* bits of INFO_FLAGS */
+enum {
+        INFO_HAS_SIZE_HINT        = 1 << 0,
+        INFO_SUPPORTS_DELETE      = 1 << 1
 };
 
+/* layout of the record save_frame() writes for each frame into the
+ * _NOTEWM_STATE property when restarting */
+enum {
+        RECORD_CHILD,
+        RECORD_WORKSPACE,
+        RECORD_X,
+        RECORD_Y,
+        RECORD_W,
+        RECORD_H,
+        RECORD_RESTORE_X,
+        RECORD_RESTORE_Y,
+        RECORD_RESTORE_W,
+        RECORD_RESTORE_H,
+        RECORD_FLAGS,
+        RECORD_INFO,
+        RECORD_SIZE = RECORD_INFO + INFO_SIZE
+};
+
+/* bits of RECORD_FLAGS */
+enum {
+        RECORD_FULLSCREEN   = 1 << 0,
+        RECORD_CHILD_MAPPED = 1 << 1
+};
+
+typedef enum {
+        COMPONENT_FRAME,
+        COMPONENT_TITLE_BAR,
+        COMPONENT_TITLE_STRING,
+        COMPONENT_CHILD,
+        COMPONENT_BUTTON
+} NoteWM_Component;
+
 typedef struct {
-        XWindowAttributes attrs;
+        Window window; /* None marks an empty slot */
+        NoteWM_Frame* frame;
+        NoteWM_Component component;
+        unsigned int button_index;
+} NoteWM_IndexEntry;
+
+typedef struct {
+        NoteWM_IndexEntry* entries;
+        unsigned int count;
+        unsigned int capacity; /* always a power of two */
+} NoteWM_WindowIndex;
+
+typedef struct {
+        int x, y, w, h; /* frame geometry when the drag started */
         XButtonEvent event;
+        /* latest pointer position of the drag, applied at most drag_rate times a second */
+        int x_root;
+        int y_root;
+        bool pending;
+        unsigned long last_update;
 } NoteWM_WindowResizeInfo;
 
 typedef struct {
@@ -130,7 +404,8 @@ typedef struct {
 
 /* ---------- globals ----------*/
 extern NoteWM_GlobalState global_state;
-extern XFontStruct* global_font;
+extern NoteWM_Theme* global_theme;
+extern Atom global_atoms[ATOM_COUNT];
 extern unsigned int global_total_bar_height;
 extern Cursor global_cursor_default;
 extern Cursor global_cursor_grab;
@@ -143,19 +418,72 @@ extern Cursor global_cursor_plus;
 /* frame.c functions */
 void add_frame(NoteWM_Frame* frame, NoteWM_Frame** list);
 void remove_frame(Display* display, NoteWM_Frame* frame, NoteWM_Frame** list);
+void attach_frame_to_workspace(NoteWM_Frame* frame, unsigned short workspace_id);
+void detach_frame_from_workspace(NoteWM_Frame* frame);
 void free_frame(Display* display, NoteWM_Frame* frame);
-NoteWM_Frame* find_frame_by_component(Window component, NoteWM_Frame* list);
+void destroy_decorations(Display* display, NoteWM_Frame* frame);
+NoteWM_Frame* find_frame_by_component(Window component, NoteWM_Component* type);
 bool is_button(Window window, NoteWM_Frame* frame);
-NoteWM_Frame* create_frame(Display* display, Window window, Window root);
+NoteWM_Frame* create_frame(Display* display, NoteWM_ClientInfo* info, Window root);
+NoteWM_Frame* create_frame_at(Display* display, NoteWM_ClientInfo* info, Window root, int x, int y, int width, int height, bool map_client);
+void create_frame_window(Display* display, Window root, NoteWM_Frame* frame);
 void create_title_bar(Display* display, NoteWM_Frame* frame);
+void save_frame(NoteWM_Frame* frame, long* record);
+NoteWM_Frame* restore_frame(Display* display, Window root, const long* record, NoteWM_ClientInfo* info);
+void set_frame_geometry(NoteWM_Frame* frame, int x, int y, int width, int height);
 void resize_frame(Display* display, NoteWM_Frame* frame, int width, int height, bool is_event);
+void move_frame(Display* display, NoteWM_Frame* frame, int x, int y);
 void move_resize_frame(Display* display, NoteWM_Frame* frame, int x, int y, int width, int height);
+void map_frame(Display* display, NoteWM_Frame* frame);
+void unmap_frame(Display* display, NoteWM_Frame* frame);
 void update_frame_text(Display* display, NoteWM_Frame* frame);
+void expose_frame_title(Display* display, NoteWM_Frame* frame, XExposeEvent* e);
+int find_button_at(NoteWM_Frame* frame, int x, int y);
+void mark_frame_dirty(NoteWM_Frame* frame, unsigned int dirty);
+void paint_dirty_frames(Display* display);
+void schedule_title_update(NoteWM_Frame* frame);
+void flush_title_updates(void);
+long title_update_timeout(void);
 void set_frame_fullscreen(Display* display, NoteWM_Frame* frame, bool fullscreen);
-void create_button(Display* display, NoteWM_Frame* frame, unsigned long color, unsigned long mask, ButtonClickFunc event_function);
-NoteWM_ButtonList* init_button_list(unsigned int initial_capacity);
+void create_button(Display* display, NoteWM_Frame* frame, NoteWM_ButtonStyle style, unsigned long mask, ButtonClickFunc event_function);
 void append_button(NoteWM_ButtonList* button_list, NoteWM_Button button);
-void free_button_list(NoteWM_ButtonList* button_list);
+
+/* client_info.c functions */
+void query_client_info(Display* display, Window window, NoteWM_ClientQuery* query);
+bool collect_client_info(Display* display, NoteWM_ClientQuery* query, NoteWM_ClientInfo* info);
+void refresh_client_query(Display* display, NoteWM_ClientQuery* query, Atom atom);
+void discard_client_query(Display* display, NoteWM_ClientQuery* query);
+void prefetch_client_info(Display* display, Window window);
+void refresh_pending_client(Display* display, Window window, Atom atom);
+void evict_pending_client(Display* display, Window window, bool destroyed);
+bool take_pending_client(Window window, NoteWM_ClientQuery* query);
+void invalidate_frame_property(NoteWM_Frame* frame, Atom atom);
+void refresh_frame_info(Display* display, NoteWM_Frame* frame);
+bool client_has_state(NoteWM_ClientInfo* info, Atom state);
+Atom client_window_type(NoteWM_ClientInfo* info);
+bool is_framed_window_type(NoteWM_ClientInfo* info);
+void save_client_info(NoteWM_ClientInfo* info, long* record);
+void restore_client_info(const long* record, NoteWM_ClientInfo* info);
+
+/* frame_slab.c functions */
+NoteWM_Frame* alloc_frame(void);
+void dealloc_frame(NoteWM_Frame* frame);
+void free_frame_slabs(void);
+
+/* decoration_pool.c functions */
+NoteWM_Frame* take_decorations(void);
+bool return_decorations(Display* display, NoteWM_Frame* frame);
+void refill_decoration_pool(Display* display, Window root);
+void drain_decoration_pool(Display* display);
+bool is_pooled_window(Window window);
+
+/* window_index.c functions */
+void index_window(Window window, NoteWM_Frame* frame, NoteWM_Component component, unsigned int button_index);
+void unindex_window(Window window);
+void index_frame(NoteWM_Frame* frame);
+void unindex_frame(NoteWM_Frame* frame);
+NoteWM_IndexEntry* lookup_window(Window window);
+void free_window_index(void);
 
 /* events.c functions */
 void handle_close_button(Display* display, Window root, NoteWM_Frame* frame, NoteWM_Frame** list);
@@ -163,45 +491,75 @@ void handle_expand_button(Display* display, Window root, NoteWM_Frame* frame, No
 void handle_split_left_button(Display* display, Window root, NoteWM_Frame* frame, NoteWM_Frame** list);
 void handle_split_right_button(Display* display, Window root, NoteWM_Frame* frame, NoteWM_Frame** list);
 
-void handle_key_press(Display* display, Window root, XKeyEvent* e, NoteWM_Frame* list);
+void handle_key_press(Display* display, Window root, XKeyEvent* e);
 void handle_button_press(Display* display, Window root, XButtonEvent* e, NoteWM_Frame** list);
-void handle_motion_notify(Display* display, XButtonEvent* e, NoteWM_WindowResizeInfo r_info, NoteWM_Frame* list);
-void handle_unmap_notify(Display* display, Window root, XUnmapEvent* e, NoteWM_Frame** list);
-void handle_destroy_notify(Display* display, Window root, XDestroyWindowEvent* e, NoteWM_Frame** list);
+void handle_motion_notify(Display* display, XMotionEvent* e, NoteWM_WindowResizeInfo* r_info);
+void apply_pending_motion(Display* display, NoteWM_WindowResizeInfo* r_info, bool force);
+long pending_motion_timeout(NoteWM_WindowResizeInfo* r_info);
+void handle_unmap_notify(Display* display, Window root, XUnmapEvent* e);
+void handle_destroy_notify(Display* display, XDestroyWindowEvent* e, NoteWM_Frame** list);
 void handle_map_request(Display* display, Window root, XMapRequestEvent* e, NoteWM_Frame** list);
-void handle_configure_request(Display* display, XConfigureRequestEvent* e, NoteWM_Frame* list);
-void handle_resize_request(Display* display, XResizeRequestEvent* e, NoteWM_Frame* list);
-void handle_property_notify(Display* display, XPropertyEvent* e, NoteWM_Frame* list);
+void handle_configure_request(Display* display, XConfigureRequestEvent* e);
+void handle_resize_request(Display* display, XResizeRequestEvent* e);
+void handle_configure_notify(Display* display, XConfigureEvent* e);
+void handle_create_notify(Display* display, Window root, XCreateWindowEvent* e);
+void handle_property_notify(Display* display, XPropertyEvent* e);
 void handle_client_message(Display* display, Window root, XClientMessageEvent* e, NoteWM_Frame** list);
 void handle_reparent_notify(Display* display, Window root, XReparentEvent* e, NoteWM_Frame** list);
-void handle_enter_notify(Display* display, Window root, XCrossingEvent* e, NoteWM_Frame* list);
+void handle_enter_notify(Display* display, Window root, XCrossingEvent* e);
 void send_configure_notify(Display* display, NoteWM_Frame* frame);
 
 /* window_manager.c functions */
+void init_atoms(Display* display);
 void update_net_client_list(Display* display, Window root);
-void add_client_window(Display* display, Window root, Window window);
-void remove_client_window(Display* display, Window root, Window window);
+void add_client_window(NoteWM_Frame* frame);
+void remove_client_window(NoteWM_Frame* frame);
 void free_client_window_list(void);
+void run_deferred_work(Display* display, Window root);
 void set_ewhm_desktop_properties(Display* display, Window root);
 void set_net_wm_desktop(Display* display, Window window, int workspace_id);
 void set_net_supported(Display* display, Window root);
-void switch_to_workspace(Display* display, Window root, unsigned short new_workspace, NoteWM_Frame* list);
-void focus_window(Display* display, Window window, NoteWM_Frame* list);
+void switch_to_workspace(Display* display, Window root, unsigned short new_workspace);
+void focus_window(Display* display, Window window);
+void ignore_crossing_events(Display* display);
 void map_window(Display* display, Window root, Window window, NoteWM_Frame** list);
+void manage_client(Display* display, Window root, NoteWM_ClientInfo* info, NoteWM_Frame** list);
 void get_display_dimensions(Display* display, int* width, int* height);
-void update_window_type(Display* display, Window window);
-Atom get_atom(Display* display, Window window, const char* atom_name);
+unsigned long get_time_ms(void);
+void update_window_type(Display* display, NoteWM_Frame* frame);
 void grab_change_cursor(Display* display, Window window, Cursor cursor);
 void adopt_existing_windows(Display* display, Window root, NoteWM_Frame** list);
-void launch_program(const char* program);
 void grab_keys(Display* display, Window root, NoteWM_KeyBinding* keybindings);
 void grab_buttons(Display* display, Window root, NoteWM_MouseBinding* mousebindings);
-int get_window_name(Display* display, Window window, char* text, unsigned int size);
-void close_frame(Display* display, Window root, NoteWM_Frame* frame, NoteWM_Frame** list);
-void map_noframe_window(Display* display, Window window);
+void close_frame(Display* display, NoteWM_Frame* frame, NoteWM_Frame** list);
+void map_noframe_window(Display* display, NoteWM_ClientInfo* info);
+void ignore_errors_begin(Display* display);
+void ignore_errors_end(Display* display);
 int xerror_handler(Display *display, XErrorEvent *error);
-bool is_valid_window(Display* display, Window window);
+
+/* spawn.c functions */
+int init_spawn(Display* display);
+void reap_children(int fd);
+void launch_program(const char* command);
 
 /* config.c functions */
 int conf_handler(void* user, const char* section, const char* name, const char* value);
+void load_config(NoteWM_Config* conf);
+
+/* restart.c functions */
+void save_state(Display* display, Window root, NoteWM_Frame* list);
+bool restore_state(Display* display, Window root, NoteWM_Frame** list);
+int restart_notewm(char** argv);
+
+/* theme.c functions */
+NoteWM_Theme* create_theme(Display* display, Window root);
+NoteWM_Theme* acquire_theme(NoteWM_Theme* theme);
+void release_theme(Display* display, NoteWM_Theme* theme);
+void reload_theme(Display* display, Window root);
+
+/* text.c functions */
+NoteWM_GlyphCache* create_glyph_cache(Display* display, Window root, unsigned long color);
+void free_glyph_cache(Display* display, NoteWM_GlyphCache* cache);
+void print_glyph_cache_stats(NoteWM_GlyphCache* cache);
+void draw_text(Display* display, NoteWM_Theme* theme, Drawable drawable, int x, int y, const char* text, int max_width);
 #endif
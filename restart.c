@@ -0,0 +1,192 @@
+/*
+ * file: restart.c
+ * ---------------
+ * This file contains the functions for restarting NoteWM in place. Before
+ * exiting, every frame and the properties cached for its client are saved
+ * into the _NOTEWM_STATE property on the root window, bottom of the stack
+ * first, and the connection is closed with RetainTemporary so the frames
+ * outlive it. The new process frames the clients again from the property
+ * without asking for their properties, and then kills the retained windows
+ * of the old process with XKillClient(AllTemporary).
+ *
+ * Author: Mason Armand
+ * Date Created: Jun 1, 2023
+ * Last Modified: Jun 8, 2023
+ */
+#include "notewm.h"
+
+#define STATE_VERSION 2
+/* upper bound on the property size read back, in 32 bit units */
+#define MAX_STATE_LENGTH (1L << 24)
+
+/* layout of the start of _NOTEWM_STATE, followed by one record per frame */
+enum {
+        STATE_HEADER_VERSION,
+        STATE_HEADER_WORKSPACE,
+        STATE_HEADER_FOCUS,
+        STATE_HEADER_NUM_FRAMES,
+        STATE_HEADER_SIZE
+};
+
+bool valid_state(const long* state, unsigned long length);
+
+
+/* saves every frame into _NOTEWM_STATE. the frames are kept alive until the
+ * new process has framed their clients again, see restore_state() */
+void save_state(Display* display, Window root, NoteWM_Frame* list)
+{
+        NoteWM_Frame* frame;
+        NoteWM_Component component;
+        Window root_return, parent_return;
+        Window* children = NULL;
+        Window focus;
+        unsigned int num_children = 0;
+        unsigned int num_frames = 0;
+        unsigned int i;
+        unsigned long length;
+        long* state;
+        int revert_to;
+
+        for (frame = list; frame; frame = frame->next)
+                num_frames++;
+
+        length = STATE_HEADER_SIZE + (unsigned long) num_frames * RECORD_SIZE;
+        state = malloc(length * sizeof(long));
+        state[STATE_HEADER_VERSION] = STATE_VERSION;
+        state[STATE_HEADER_WORKSPACE] = global_state.current_workspace;
+
+        XGetInputFocus(display, &focus, &revert_to);
+        frame = find_frame_by_component(focus, &component);
+        state[STATE_HEADER_FOCUS] = (frame && component == COMPONENT_CHILD) ? (long) focus : (long) None;
+
+        /* the new frames are created on top of each other in record order,
+         * so saving them bottom first keeps the stacking order */
+        num_frames = 0;
+        if (XQueryTree(display, root, &root_return, &parent_return, &children, &num_children)) {
+                for (i = 0; i < num_children; i++) {
+                        frame = find_frame_by_component(children[i], &component);
+                        if (!frame || component != COMPONENT_FRAME)
+                                continue;
+                        save_frame(frame, &state[STATE_HEADER_SIZE + num_frames * RECORD_SIZE]);
+                        num_frames++;
+                }
+                if (children)
+                        XFree(children);
+        }
+        state[STATE_HEADER_NUM_FRAMES] = num_frames;
+        length = STATE_HEADER_SIZE + (unsigned long) num_frames * RECORD_SIZE;
+
+        XChangeProperty(
+                display, root, global_atoms[ATOM_NOTEWM_STATE], XA_CARDINAL, 32,
+                PropModeReplace, (unsigned char*) state, length
+        );
+        free(state);
+
+        /* RetainPermanent would leave the old connection's resources behind
+         * for good, these are freed by the next NoteWM's XKillClient() */
+        XSetCloseDownMode(display, RetainTemporary);
+}
+
+
+bool valid_state(const long* state, unsigned long length)
+{
+        unsigned long num_frames;
+
+        if (length < STATE_HEADER_SIZE || state[STATE_HEADER_VERSION] != STATE_VERSION)
+                return false;
+
+        num_frames = state[STATE_HEADER_NUM_FRAMES];
+        return length == STATE_HEADER_SIZE + num_frames * RECORD_SIZE;
+}
+
+
+/* frames the clients saved by a NoteWM that restarted. the property is
+ * deleted as it is read, so a later start does not pick it up again.
+ * returns false if there was nothing to restore */
+bool restore_state(Display* display, Window root, NoteWM_Frame** list)
+{
+        xcb_connection_t* conn = XGetXCBConnection(display);
+        xcb_get_window_attributes_cookie_t* cookies;
+        xcb_get_window_attributes_reply_t* reply;
+        NoteWM_ClientInfo info;
+        NoteWM_Frame* frame;
+        unsigned char* data = NULL;
+        unsigned long length;
+        unsigned long after;
+        unsigned long num_frames;
+        unsigned long num_restored = 0;
+        unsigned long i;
+        long* state;
+        Window focus;
+        Atom type;
+        int format;
+
+        if (XGetWindowProperty(display, root, global_atoms[ATOM_NOTEWM_STATE], 0, MAX_STATE_LENGTH, true, XA_CARDINAL,
+                &type, &format, &length, &after, &data) != Success || !data)
+                return false;
+
+        state = (long*) data;
+        if (format != 32 || !valid_state(state, length)) {
+                fprintf(stderr, "Ignoring invalid saved state\n");
+                /* the old frames still hold their clients, killing them puts
+                 * the clients back on the root window to be adopted */
+                XKillClient(display, AllTemporary);
+                XFree(data);
+                return false;
+        }
+
+        num_frames = state[STATE_HEADER_NUM_FRAMES];
+        if (state[STATE_HEADER_WORKSPACE] >= 0 && state[STATE_HEADER_WORKSPACE] < NUM_WORKSPACES)
+                global_state.current_workspace = state[STATE_HEADER_WORKSPACE];
+
+        /* the properties of each client are in its record, so the only thing
+         * to ask the server is whether the client is still there. property
+         * changes made while no window manager was running are missed */
+        cookies = malloc(num_frames * sizeof(xcb_get_window_attributes_cookie_t));
+        for (i = 0; i < num_frames; i++)
+                cookies[i] = xcb_get_window_attributes(conn, state[STATE_HEADER_SIZE + i * RECORD_SIZE + RECORD_CHILD]);
+
+        ignore_errors_begin(display);
+        for (i = 0; i < num_frames; i++) {
+                const long* record = &state[STATE_HEADER_SIZE + i * RECORD_SIZE];
+
+                if (!(reply = xcb_get_window_attributes_reply(conn, cookies[i], NULL)))
+                        continue;
+
+                memset(&info, 0, sizeof(info));
+                info.window = record[RECORD_CHILD];
+                info.valid = true;
+                info.override_redirect = reply->override_redirect;
+                info.map_state = reply->map_state;
+                free(reply);
+
+                frame = restore_frame(display, root, record, &info);
+                add_frame(frame, list);
+                num_restored++;
+        }
+
+        /* every client has left the old frames, so they can go. a client
+         * that was not restored is put back on the root window by the save set */
+        XKillClient(display, AllTemporary);
+
+        focus = state[STATE_HEADER_FOCUS];
+        if (focus != None && lookup_window(focus))
+                XSetInputFocus(display, focus, RevertToPointerRoot, CurrentTime);
+        ignore_errors_end(display);
+
+        free(cookies);
+        XFree(data);
+        printf("restored %lu of %lu frames\n", num_restored, num_frames);
+        return true;
+}
+
+
+/* replaces this process with the notewm binary it was started as, so a
+ * rebuilt NoteWM is picked up. only returns on failure */
+int restart_notewm(char** argv)
+{
+        execvp(argv[0], argv);
+        execlp("notewm", "notewm", (char*) NULL);
+        perror("Failed to restart NoteWM");
+        return 1;
+}
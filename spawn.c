@@ -0,0 +1,93 @@
+/*
+ * file: spawn.c
+ * -------------
+ * This file contains functions for launching programs without blocking the
+ * window manager, and for reaping them once they exit. SIGCHLD is blocked and
+ * read from a signalfd, which the main loop waits on next to the X connection.
+ *
+ * Author: Mason Armand
+ * Date Created: Jun 1, 2023
+ * Last Modified: Jun 8, 2023
+ */
+#include "notewm.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+
+int init_spawn(Display* display)
+{
+        sigset_t mask;
+        int fd;
+
+        /* children must not inherit our connection to the X server */
+        fcntl(ConnectionNumber(display), F_SETFD, FD_CLOEXEC);
+
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+        if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0) {
+                perror("sigprocmask");
+                return -1;
+        }
+
+        fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (fd < 0)
+                perror("signalfd");
+
+        /* collect anything that exited before SIGCHLD was blocked */
+        reap_children(-1);
+        return fd;
+}
+
+
+void reap_children(int fd)
+{
+        struct signalfd_siginfo info;
+
+        /* signals are coalesced, so one read can stand for several children */
+        if (fd >= 0) {
+                while (read(fd, &info, sizeof(info)) == sizeof(info))
+                        ;
+        }
+
+        while (waitpid(-1, NULL, WNOHANG) > 0)
+                ;
+}
+
+
+void launch_program(const char* command)
+{
+        posix_spawnattr_t attr;
+        sigset_t empty_mask;
+        sigset_t default_signals;
+        char* argv[4];
+        pid_t pid;
+        int error;
+
+        if (!command || !command[0])
+                return;
+
+        argv[0] = (char*) "sh";
+        argv[1] = (char*) "-c";
+        argv[2] = (char*) command;
+        argv[3] = NULL;
+
+        sigemptyset(&empty_mask);
+        sigemptyset(&default_signals);
+        sigaddset(&default_signals, SIGCHLD);
+
+        /* start the child in its own session with the signal state it would
+         * have had if we never touched SIGCHLD */
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+        posix_spawnattr_setsigmask(&attr, &empty_mask);
+        posix_spawnattr_setsigdefault(&attr, &default_signals);
+
+        error = posix_spawn(&pid, "/bin/sh", NULL, &attr, argv, environ);
+        if (error != 0)
+                fprintf(stderr, "Failed to launch '%s': %s\n", command, strerror(error));
+
+        posix_spawnattr_destroy(&attr);
+}
@@ -0,0 +1,473 @@
+/*
+ * file: text.c
+ * ------------
+ * This file contains the functions for drawing UTF-8 titles. Glyphs are drawn
+ * with the core font once, uploaded into an XRender GlyphSet and from then on
+ * a title only costs the upload of its glyph indices. The GlyphSet holds a
+ * fixed number of glyphs and the least recently used one is replaced when it
+ * is full.
+ *
+ * If the server has no RENDER extension titles are drawn with XDrawString16,
+ * which works because the title font is an iso10646 font.
+ *
+ * Author: Mason Armand
+ * Date Created: Jun 1, 2023
+ * Last Modified: Jun 8, 2023
+ */
+#include "notewm.h"
+
+#define REPLACEMENT_CHARACTER 0xfffd
+
+unsigned int decode_utf8(const char* text, unsigned long* codepoints, unsigned int max);
+unsigned int glyph_hash(unsigned long codepoint);
+void unlink_lru(NoteWM_GlyphCache* cache, int slot);
+void push_lru(NoteWM_GlyphCache* cache, int slot);
+void unhash_glyph(NoteWM_GlyphCache* cache, int slot);
+int find_glyph(NoteWM_GlyphCache* cache, unsigned long codepoint);
+int allocate_glyph(Display* display, NoteWM_GlyphCache* cache);
+int reserve_glyph(Display* display, NoteWM_GlyphCache* cache, unsigned long codepoint, bool* missed);
+void upload_glyphs(Display* display, NoteWM_GlyphCache* cache, Font font, const int* slots, unsigned int count);
+int char_width(Display* display, NoteWM_Theme* theme, XChar2b* c);
+
+
+/* ---------- UTF-8 ---------- */
+/* decodes up to max characters of text. malformed sequences, overlong forms,
+ * surrogates and anything past U+10FFFF decode to U+FFFD */
+unsigned int decode_utf8(const char* text, unsigned long* codepoints, unsigned int max)
+{
+        const unsigned char* s = (const unsigned char*) text;
+        unsigned int count = 0;
+
+        while (*s && count < max) {
+                unsigned long c = *s++;
+                unsigned long min = 0;
+                int extra = 0;
+                int i;
+
+                if (c >= 0xf8) {
+                        c = REPLACEMENT_CHARACTER;
+                }
+                else if (c >= 0xf0) {
+                        c &= 0x07;
+                        min = 0x10000;
+                        extra = 3;
+                }
+                else if (c >= 0xe0) {
+                        c &= 0x0f;
+                        min = 0x800;
+                        extra = 2;
+                }
+                else if (c >= 0xc0) {
+                        c &= 0x1f;
+                        min = 0x80;
+                        extra = 1;
+                }
+                else if (c >= 0x80) {
+                        c = REPLACEMENT_CHARACTER;
+                }
+
+                for (i = 0; i < extra; i++) {
+                        if ((*s & 0xc0) != 0x80) {
+                                c = REPLACEMENT_CHARACTER;
+                                extra = 0;
+                                break;
+                        }
+                        c = (c << 6) | (*s++ & 0x3f);
+                }
+
+                if (extra && (c < min || (c >= 0xd800 && c <= 0xdfff) || c > 0x10ffff))
+                        c = REPLACEMENT_CHARACTER;
+                codepoints[count++] = c;
+        }
+        return count;
+}
+
+
+/* ---------- Glyph Cache ---------- */
+NoteWM_GlyphCache* create_glyph_cache(Display* display, Window root, unsigned long color)
+{
+        NoteWM_GlyphCache* cache;
+        XRenderColor fill;
+        int event_base;
+        int error_base;
+        int i;
+
+        if (!XRenderQueryExtension(display, &event_base, &error_base))
+                return NULL;
+
+        cache = malloc(sizeof(NoteWM_GlyphCache));
+        cache->glyph_format = XRenderFindStandardFormat(display, PictStandardA8);
+        cache->target_format = XRenderFindVisualFormat(display, DefaultVisual(display, DefaultScreen(display)));
+        cache->glyphset = XRenderCreateGlyphSet(display, cache->glyph_format);
+
+        fill.red = ((color >> 16) & 0xff) * 0x101;
+        fill.green = ((color >> 8) & 0xff) * 0x101;
+        fill.blue = (color & 0xff) * 0x101;
+        fill.alpha = 0xffff;
+        cache->fill = XRenderCreateSolidFill(display, &fill);
+
+        /* glyphs are drawn into a bitmap with the core font before being uploaded */
+        cache->bitmap = XCreatePixmap(display, root, 1, 1, 1);
+        cache->bitmap_gc = XCreateGC(display, cache->bitmap, 0, NULL);
+
+        for (i = 0; i < GLYPH_HASH_SIZE; i++)
+                cache->hash[i] = -1;
+        cache->lru_head = -1;
+        cache->lru_tail = -1;
+        cache->count = 0;
+        cache->hits = 0;
+        cache->misses = 0;
+        cache->evictions = 0;
+
+        return cache;
+}
+
+
+void free_glyph_cache(Display* display, NoteWM_GlyphCache* cache)
+{
+        XRenderFreeGlyphSet(display, cache->glyphset);
+        XRenderFreePicture(display, cache->fill);
+        XFreeGC(display, cache->bitmap_gc);
+        XFreePixmap(display, cache->bitmap);
+        free(cache);
+}
+
+
+unsigned int glyph_hash(unsigned long codepoint)
+{
+        return (codepoint * 2654435761UL) & (GLYPH_HASH_SIZE - 1);
+}
+
+
+void unlink_lru(NoteWM_GlyphCache* cache, int slot)
+{
+        NoteWM_CachedGlyph* glyph = &cache->glyphs[slot];
+
+        if (glyph->prev >= 0)
+                cache->glyphs[glyph->prev].next = glyph->next;
+        else
+                cache->lru_head = glyph->next;
+
+        if (glyph->next >= 0)
+                cache->glyphs[glyph->next].prev = glyph->prev;
+        else
+                cache->lru_tail = glyph->prev;
+}
+
+
+/* makes slot the most recently used glyph */
+void push_lru(NoteWM_GlyphCache* cache, int slot)
+{
+        NoteWM_CachedGlyph* glyph = &cache->glyphs[slot];
+
+        glyph->prev = -1;
+        glyph->next = cache->lru_head;
+        if (cache->lru_head >= 0)
+                cache->glyphs[cache->lru_head].prev = slot;
+        else
+                cache->lru_tail = slot;
+        cache->lru_head = slot;
+}
+
+
+void unhash_glyph(NoteWM_GlyphCache* cache, int slot)
+{
+        int* link = &cache->hash[glyph_hash(cache->glyphs[slot].codepoint)];
+
+        while (*link >= 0) {
+                if (*link == slot) {
+                        *link = cache->glyphs[slot].hash_next;
+                        return;
+                }
+                link = &cache->glyphs[*link].hash_next;
+        }
+}
+
+
+int find_glyph(NoteWM_GlyphCache* cache, unsigned long codepoint)
+{
+        int slot;
+
+        for (slot = cache->hash[glyph_hash(codepoint)]; slot >= 0; slot = cache->glyphs[slot].hash_next) {
+                if (cache->glyphs[slot].codepoint == codepoint)
+                        return slot;
+        }
+        return -1;
+}
+
+
+/* prints how well the cache has done, when the theme it belongs to is
+ * replaced and when NoteWM exits */
+void print_glyph_cache_stats(NoteWM_GlyphCache* cache)
+{
+        printf("glyph cache: %lu hits, %lu misses, %lu evictions\n", cache->hits, cache->misses, cache->evictions);
+}
+
+
+/* returns a free slot, evicting the least recently used glyph if the cache is full */
+int allocate_glyph(Display* display, NoteWM_GlyphCache* cache)
+{
+        Glyph id;
+        int slot;
+
+        if (cache->count < GLYPH_CACHE_SIZE)
+                return cache->count++;
+
+        slot = cache->lru_tail;
+        unlink_lru(cache, slot);
+        unhash_glyph(cache, slot);
+
+        id = slot;
+        XRenderFreeGlyphs(display, cache->glyphset, &id, 1);
+        cache->evictions++;
+        return slot;
+}
+
+
+/* returns the slot holding codepoint. a codepoint that is not cached gets a
+ * slot right away, but its glyph is only uploaded by upload_glyphs(), so
+ * missed is set to tell the caller to add the slot to its batch */
+int reserve_glyph(Display* display, NoteWM_GlyphCache* cache, unsigned long codepoint, bool* missed)
+{
+        NoteWM_CachedGlyph* glyph;
+        unsigned int hash;
+        int slot = find_glyph(cache, codepoint);
+
+        *missed = (slot < 0);
+        if (slot >= 0) {
+                cache->hits++;
+                unlink_lru(cache, slot);
+                push_lru(cache, slot);
+                return slot;
+        }
+
+        cache->misses++;
+        slot = allocate_glyph(display, cache);
+        glyph = &cache->glyphs[slot];
+        glyph->codepoint = codepoint;
+        glyph->advance = 0;
+
+        hash = glyph_hash(codepoint);
+        glyph->hash_next = cache->hash[hash];
+        cache->hash[hash] = slot;
+        push_lru(cache, slot);
+        return slot;
+}
+
+
+/* draws the glyphs for slots with the core font and adds them to the glyph
+ * set in a single request. the extents of every glyph are asked for together,
+ * and then the images of every glyph, so a title full of new characters costs
+ * two round trips instead of two for each character. the slot number doubles
+ * as the glyph id */
+void upload_glyphs(Display* display, NoteWM_GlyphCache* cache, Font font, const int* slots, unsigned int count)
+{
+        xcb_connection_t* conn = XGetXCBConnection(display);
+        xcb_query_text_extents_cookie_t extents[MAX_TITLE_LENGTH];
+        xcb_get_image_cookie_t images[MAX_TITLE_LENGTH];
+        xcb_query_text_extents_reply_t* extents_reply;
+        xcb_get_image_reply_t* image_reply;
+        XGlyphInfo info[MAX_TITLE_LENGTH];
+        Glyph ids[MAX_TITLE_LENGTH];
+        bool inked[MAX_TITLE_LENGTH];
+        xcb_char2b_t c;
+        XChar2b glyph_char;
+        Pixmap bitmap;
+        XImage* image;
+        char* data = NULL;
+        char* glyph_data;
+        unsigned long size = 0;
+        unsigned int i;
+        int stride;
+        int x;
+        int y;
+
+        if (count > MAX_TITLE_LENGTH)
+                count = MAX_TITLE_LENGTH;
+
+        for (i = 0; i < count; i++) {
+                c.byte1 = (cache->glyphs[slots[i]].codepoint >> 8) & 0xff;
+                c.byte2 = cache->glyphs[slots[i]].codepoint & 0xff;
+                extents[i] = xcb_query_text_extents(conn, font, 1, &c);
+        }
+
+        XSetFont(display, cache->bitmap_gc, font);
+        for (i = 0; i < count; i++) {
+                ids[i] = slots[i];
+                memset(&info[i], 0, sizeof(XGlyphInfo));
+                if ((extents_reply = xcb_query_text_extents_reply(conn, extents[i], NULL))) {
+                        info[i].width = (extents_reply->overall_right > extents_reply->overall_left)
+                                ? extents_reply->overall_right - extents_reply->overall_left : 0;
+                        info[i].height = (extents_reply->overall_ascent + extents_reply->overall_descent > 0)
+                                ? extents_reply->overall_ascent + extents_reply->overall_descent : 0;
+                        info[i].x = -extents_reply->overall_left;
+                        info[i].y = extents_reply->overall_ascent;
+                        info[i].xOff = extents_reply->overall_width;
+                        free(extents_reply);
+                }
+                cache->glyphs[slots[i]].advance = info[i].xOff;
+
+                /* A8 rows are padded to four bytes */
+                size += ((info[i].width + 3) & ~3) * info[i].height;
+                inked[i] = (info[i].width > 0 && info[i].height > 0);
+                if (!inked[i])
+                        continue;
+
+                glyph_char.byte1 = (cache->glyphs[slots[i]].codepoint >> 8) & 0xff;
+                glyph_char.byte2 = cache->glyphs[slots[i]].codepoint & 0xff;
+                bitmap = XCreatePixmap(display, cache->bitmap, info[i].width, info[i].height, 1);
+                XSetForeground(display, cache->bitmap_gc, 0);
+                XFillRectangle(display, bitmap, cache->bitmap_gc, 0, 0, info[i].width, info[i].height);
+                XSetForeground(display, cache->bitmap_gc, 1);
+                XDrawString16(display, bitmap, cache->bitmap_gc, info[i].x, info[i].y, &glyph_char, 1);
+                images[i] = xcb_get_image(conn, XCB_IMAGE_FORMAT_XY_PIXMAP, bitmap, 0, 0, info[i].width, info[i].height, 1);
+                XFreePixmap(display, bitmap);
+        }
+
+        if (size > 0)
+                data = calloc(size, 1);
+
+        /* the glyph images follow each other in the order of their glyph infos */
+        glyph_data = data;
+        for (i = 0; i < count; i++) {
+                stride = (info[i].width + 3) & ~3;
+                if (!inked[i])
+                        continue;
+
+                if ((image_reply = xcb_get_image_reply(conn, images[i], NULL))) {
+                        /* wrapping the reply in an XImage leaves the bit and
+                         * byte order of the server to XGetPixel */
+                        image = XCreateImage(
+                                display, DefaultVisual(display, DefaultScreen(display)), 1, XYPixmap, 0,
+                                (char*) xcb_get_image_data(image_reply), info[i].width, info[i].height,
+                                BitmapPad(display), 0
+                        );
+                        if (image && xcb_get_image_data_length(image_reply) >= image->bytes_per_line * info[i].height) {
+                                for (y = 0; y < info[i].height; y++) {
+                                        for (x = 0; x < info[i].width; x++) {
+                                                if (XGetPixel(image, x, y))
+                                                        glyph_data[y * stride + x] = (char) 0xff;
+                                        }
+                                }
+                        }
+                        if (image) {
+                                /* the data belongs to the reply */
+                                image->data = NULL;
+                                XDestroyImage(image);
+                        }
+                        free(image_reply);
+                }
+                glyph_data += stride * info[i].height;
+        }
+
+        XRenderAddGlyphs(display, cache->glyphset, ids, info, count, data, size);
+        free(data);
+}
+
+
+/* ---------- Drawing ---------- */
+/* returns the width of a character drawn with the core font, only asking
+ * the server for characters it has not been asked about before */
+int char_width(Display* display, NoteWM_Theme* theme, XChar2b* c)
+{
+        XCharStruct overall;
+        int direction;
+        int ascent;
+        int descent;
+
+        if (theme->fixed_width)
+                return theme->fixed_width;
+        if (c->byte1 == 0 && theme->widths[c->byte2] >= 0)
+                return theme->widths[c->byte2];
+
+        XQueryTextExtents16(display, theme->font, c, 1, &direction, &ascent, &descent, &overall);
+        if (c->byte1 == 0)
+                theme->widths[c->byte2] = overall.width;
+        return overall.width;
+}
+
+
+/* draws as much of the UTF-8 string text as fits in max_width pixels with its
+ * baseline at (x, y) */
+void draw_text(Display* display, NoteWM_Theme* theme, Drawable drawable, int x, int y, const char* text, int max_width)
+{
+        unsigned long codepoints[MAX_TITLE_LENGTH];
+        unsigned int glyphs[MAX_TITLE_LENGTH];
+        XChar2b chars[MAX_TITLE_LENGTH];
+        unsigned int count = decode_utf8(text, codepoints, MAX_TITLE_LENGTH);
+        int missed_slots[MAX_TITLE_LENGTH];
+        unsigned int num_missed;
+        unsigned int reserved;
+        unsigned int fits = 0;
+        unsigned int i;
+        int width = 0;
+        int pen;
+        int advance;
+        bool missed;
+        bool full = false;
+        Picture picture;
+
+        for (i = 0; i < count; i++) {
+                /* the core font only has the basic multilingual plane */
+                if (codepoints[i] > 0xffff)
+                        codepoints[i] = '?';
+
+                chars[i].byte1 = (codepoints[i] >> 8) & 0xff;
+                chars[i].byte2 = codepoints[i] & 0xff;
+        }
+
+        if (!theme->glyphs) {
+                for (; fits < count; fits++) {
+                        advance = char_width(display, theme, &chars[fits]);
+                        if (width + advance > max_width)
+                                break;
+                        width += advance;
+                }
+                if (fits > 0)
+                        XDrawString16(display, drawable, theme->gcs[GC_TITLE_TEXT], x, y, chars, fits);
+                return;
+        }
+
+        /* glyphs are only reserved until the pen could be past max_width,
+         * taking the widest advance of the font for glyphs that are not
+         * cached yet. those are uploaded together, and if the real advances
+         * leave room, the next stretch of the title is reserved the same way.
+         * with a monospaced font the guess is exact, so one pass does */
+        while (fits < count && !full) {
+                pen = width;
+                num_missed = 0;
+                for (reserved = fits; reserved < count && pen <= max_width; reserved++) {
+                        glyphs[reserved] = reserve_glyph(display, theme->glyphs, codepoints[reserved], &missed);
+                        if (missed) {
+                                missed_slots[num_missed++] = glyphs[reserved];
+                                pen += theme->max_advance;
+                        } else {
+                                pen += theme->glyphs->glyphs[glyphs[reserved]].advance;
+                        }
+                }
+
+                if (num_missed > 0)
+                        upload_glyphs(display, theme->glyphs, theme->font, missed_slots, num_missed);
+
+                for (; fits < reserved; fits++) {
+                        advance = theme->glyphs->glyphs[glyphs[fits]].advance;
+                        if (width + advance > max_width) {
+                                full = true;
+                                break;
+                        }
+                        width += advance;
+                }
+        }
+
+        if (fits == 0)
+                return;
+
+        picture = XRenderCreatePicture(display, drawable, theme->glyphs->target_format, 0, NULL);
+        XRenderCompositeString32(
+                display, PictOpOver,
+                theme->glyphs->fill, picture, theme->glyphs->glyph_format,
+                theme->glyphs->glyphset, 0, 0,
+                x, y, glyphs, fits
+        );
+        XRenderFreePicture(display, picture);
+}
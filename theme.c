@@ -0,0 +1,188 @@
+/*
+ * file: theme.c
+ * -------------
+ * This file contains the functions for the resources shared by every frame's
+ * decorations: the font, one GC for each thing that is drawn, and the button
+ * images. Frames hold a reference to the theme they were drawn with, so when
+ * the configuration is reloaded the old theme stays alive until the paint
+ * pass has moved every frame over to the new one.
+ *
+ * Author: Mason Armand
+ * Date Created: Jun 1, 2023
+ * Last Modified: Jun 8, 2023
+ */
+#include "notewm.h"
+
+#define DEFAULT_FONT "-misc-fixed-bold-r-normal--13-120-75-75-C-70-iso10646-1"
+#define FALLBACK_FONT "fixed"
+
+bool load_font(Display* display, const char* pattern, NoteWM_Theme* theme);
+bool load_theme_font(Display* display, NoteWM_Theme* theme);
+GC create_theme_gc(Display* display, Window root, unsigned long foreground, unsigned long background);
+Pixmap create_button_pixmap(Display* display, Window root, GC gc, unsigned long color);
+void free_theme(Display* display, NoteWM_Theme* theme);
+
+NoteWM_Theme* global_theme = NULL;
+
+
+GC create_theme_gc(Display* display, Window root, unsigned long foreground, unsigned long background)
+{
+        XGCValues values;
+
+        values.foreground = foreground;
+        values.background = background;
+        values.graphics_exposures = false;
+        return XCreateGC(display, root, GCForeground | GCBackground | GCGraphicsExposures, &values);
+}
+
+
+/* draws a button with its one pixel border, the same size as NoteWM_Button.rect */
+Pixmap create_button_pixmap(Display* display, Window root, GC gc, unsigned long color)
+{
+        Pixmap pixmap = XCreatePixmap(
+                display, root,
+                BUTTON_SIZE + 2, BUTTON_SIZE + 2,
+                DefaultDepth(display, DefaultScreen(display))
+        );
+
+        XSetForeground(display, gc, global_state.conf.button_border_color);
+        XFillRectangle(display, pixmap, gc, 0, 0, BUTTON_SIZE + 2, BUTTON_SIZE + 2);
+        XSetForeground(display, gc, color);
+        XFillRectangle(display, pixmap, gc, 1, 1, BUTTON_SIZE, BUTTON_SIZE);
+        return pixmap;
+}
+
+
+/* loads the first font matching pattern. XLoadQueryFont would also read the
+ * metrics of every glyph in the font, which for an iso10646 font is tens of
+ * thousands of them, so only the font wide metrics are asked for here and the
+ * widths of the characters we actually draw are looked up when they are drawn */
+bool load_font(Display* display, const char* pattern, NoteWM_Theme* theme)
+{
+        XFontStruct* info;
+        char** names;
+        int count;
+
+        if (!pattern || !pattern[0])
+                return false;
+
+        names = XListFontsWithInfo(display, pattern, 1, &count, &info);
+        if (!names)
+                return false;
+
+        theme->font = XLoadFont(display, names[0]);
+        theme->ascent = info->ascent;
+        theme->descent = info->descent;
+        /* every glyph of a monospaced font is the same width, so their
+         * widths never have to be asked for */
+        theme->fixed_width = (info->min_bounds.width == info->max_bounds.width) ? info->max_bounds.width : 0;
+        theme->max_advance = info->max_bounds.width;
+        memset(theme->widths, 0xff, sizeof(theme->widths));
+
+        XFreeFontInfo(names, info, count);
+        return true;
+}
+
+
+/* tries the configured font, then the default one, then the font every
+ * X server has, so a missing font is not a reason to exit */
+bool load_theme_font(Display* display, NoteWM_Theme* theme)
+{
+        if (load_font(display, global_state.conf.font, theme))
+                return true;
+        if (global_state.conf.font[0])
+                fprintf(stderr, "Failed to load font '%s', falling back to the default\n", global_state.conf.font);
+
+        if (load_font(display, DEFAULT_FONT, theme) || load_font(display, FALLBACK_FONT, theme))
+                return true;
+
+        fprintf(stderr, "Failed to load font\n");
+        return false;
+}
+
+
+/* builds a theme from the current configuration. returns NULL if the font
+ * could not be loaded */
+NoteWM_Theme* create_theme(Display* display, Window root)
+{
+        NoteWM_Theme* theme;
+        NoteWM_Config* conf = &global_state.conf;
+        GC scratch;
+
+        theme = malloc(sizeof(NoteWM_Theme));
+        theme->refcount = 1;
+        if (!load_theme_font(display, theme)) {
+                free(theme);
+                return NULL;
+        }
+
+        theme->gcs[GC_TITLE_TEXT] = create_theme_gc(display, root, conf->fg_color, conf->title_bar_color);
+        XSetFont(display, theme->gcs[GC_TITLE_TEXT], theme->font);
+        theme->gcs[GC_TITLE_BACKGROUND] = create_theme_gc(display, root, conf->title_bar_color, conf->fg_color);
+        theme->gcs[GC_COPY] = create_theme_gc(display, root, conf->fg_color, conf->bg_color);
+
+        scratch = create_theme_gc(display, root, conf->fg_color, conf->bg_color);
+        theme->buttons[BUTTON_CLOSE] = create_button_pixmap(display, root, scratch, conf->close_color);
+        theme->buttons[BUTTON_EXPAND] = create_button_pixmap(display, root, scratch, conf->expand_color);
+        theme->buttons[BUTTON_SPLIT] = create_button_pixmap(display, root, scratch, conf->split_color);
+        XFreeGC(display, scratch);
+
+        theme->glyphs = create_glyph_cache(display, root, conf->fg_color);
+        return theme;
+}
+
+
+NoteWM_Theme* acquire_theme(NoteWM_Theme* theme)
+{
+        theme->refcount++;
+        return theme;
+}
+
+
+void release_theme(Display* display, NoteWM_Theme* theme)
+{
+        if (--theme->refcount == 0)
+                free_theme(display, theme);
+}
+
+
+void free_theme(Display* display, NoteWM_Theme* theme)
+{
+        unsigned int i;
+
+        for (i = 0; i < GC_COUNT; i++)
+                XFreeGC(display, theme->gcs[i]);
+        for (i = 0; i < BUTTON_STYLE_COUNT; i++)
+                XFreePixmap(display, theme->buttons[i]);
+        if (theme->glyphs)
+                free_glyph_cache(display, theme->glyphs);
+        XUnloadFont(display, theme->font);
+        free(theme);
+}
+
+
+/* re-reads the configuration and swaps in a theme built from it. frames
+ * change over to the new theme in the next paint pass */
+void reload_theme(Display* display, Window root)
+{
+        NoteWM_Theme* theme;
+        NoteWM_Frame* frame;
+        unsigned int i;
+
+        load_config(&global_state.conf);
+
+        if (!(theme = create_theme(display, root)))
+                return;
+
+        if (global_theme->glyphs)
+                print_glyph_cache_stats(global_theme->glyphs);
+        release_theme(display, global_theme);
+        global_theme = theme;
+        /* spare decorations are rebuilt with the new theme when idle */
+        drain_decoration_pool(display);
+
+        for (i = 0; i < NUM_WORKSPACES; i++) {
+                for (frame = global_state.workspaces[i]; frame; frame = frame->ws_next)
+                        mark_frame_dirty(frame, DIRTY_TITLE | DIRTY_BUTTONS | DIRTY_BORDER);
+        }
+}
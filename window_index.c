@@ -0,0 +1,182 @@
+/*
+ * file: window_index.c
+ * --------------------
+ * This file contains the window index: an open addressing hash table that
+ * maps every X window owned by a frame (the frame itself, the title bar,
+ * the title string window, the client window and each button) to that
+ * frame, along with which component of the frame the window is.
+ *
+ * Event handlers use this to find the frame an event belongs to in
+ * constant time instead of walking the frame list.
+ *
+ * Author: Mason Armand
+ * Date Created: Jun 1, 2023
+ * Last Modified: Jun 8, 2023
+ */
+#include "notewm.h"
+
+#define INDEX_INITIAL_CAPACITY 64
+
+unsigned long hash_window(Window window);
+void grow_window_index(void);
+
+static NoteWM_WindowIndex window_index = { NULL, 0, 0 };
+
+
+unsigned long hash_window(Window window)
+{
+        unsigned long hash = (unsigned long) window;
+        hash ^= hash >> 16;
+        hash *= 0x45d9f3bUL;
+        hash ^= hash >> 16;
+        return hash;
+}
+
+
+void grow_window_index(void)
+{
+        NoteWM_IndexEntry* old_entries = window_index.entries;
+        unsigned int old_capacity = window_index.capacity;
+        unsigned int i;
+
+        window_index.capacity = old_capacity ? old_capacity * 2 : INDEX_INITIAL_CAPACITY;
+        window_index.entries = calloc(window_index.capacity, sizeof(NoteWM_IndexEntry));
+        window_index.count = 0;
+
+        for (i = 0; i < old_capacity; i++) {
+                NoteWM_IndexEntry* entry = &old_entries[i];
+                if (entry->window != None)
+                        index_window(entry->window, entry->frame, entry->component, entry->button_index);
+        }
+        free(old_entries);
+}
+
+
+void index_window(Window window, NoteWM_Frame* frame, NoteWM_Component component, unsigned int button_index)
+{
+        unsigned long mask;
+        unsigned long i;
+
+        if (window == None)
+                return;
+
+        /* keep the load factor under 3/4 so probe sequences stay short */
+        if ((window_index.count + 1) * 4 > window_index.capacity * 3)
+                grow_window_index();
+
+        mask = window_index.capacity - 1;
+        i = hash_window(window) & mask;
+
+        while (window_index.entries[i].window != None
+        && window_index.entries[i].window != window) {
+                i = (i + 1) & mask;
+        }
+
+        if (window_index.entries[i].window == None)
+                window_index.count++;
+
+        window_index.entries[i].window = window;
+        window_index.entries[i].frame = frame;
+        window_index.entries[i].component = component;
+        window_index.entries[i].button_index = button_index;
+}
+
+
+void unindex_window(Window window)
+{
+        unsigned long mask;
+        unsigned long i;
+        unsigned long j;
+
+        if (window == None || window_index.count == 0)
+                return;
+
+        mask = window_index.capacity - 1;
+        i = hash_window(window) & mask;
+
+        while (window_index.entries[i].window != window) {
+                if (window_index.entries[i].window == None)
+                        return;
+                i = (i + 1) & mask;
+        }
+
+        /* backward shift deletion: pull later entries of the probe sequence
+         * into the hole so lookups never need tombstones */
+        j = i;
+        for (;;) {
+                unsigned long home;
+
+                j = (j + 1) & mask;
+                if (window_index.entries[j].window == None)
+                        break;
+
+                home = hash_window(window_index.entries[j].window) & mask;
+                /* skip entries whose home slot lies cyclically in (i, j] */
+                if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+                        continue;
+
+                window_index.entries[i] = window_index.entries[j];
+                i = j;
+        }
+
+        window_index.entries[i].window = None;
+        window_index.entries[i].frame = NULL;
+        window_index.count--;
+}
+
+
+void index_frame(NoteWM_Frame* frame)
+{
+        unsigned int i;
+
+        index_window(frame->frame, frame, COMPONENT_FRAME, 0);
+        index_window(frame->title_bar, frame, COMPONENT_TITLE_BAR, 0);
+        index_window(frame->title_string_window, frame, COMPONENT_TITLE_STRING, 0);
+        index_window(frame->child_window, frame, COMPONENT_CHILD, 0);
+
+        for (i = 0; i < frame->button_list.count; i++)
+                index_window(frame->button_list.buttons[i].window, frame, COMPONENT_BUTTON, i);
+}
+
+
+void unindex_frame(NoteWM_Frame* frame)
+{
+        unsigned int i;
+
+        unindex_window(frame->frame);
+        unindex_window(frame->title_bar);
+        unindex_window(frame->title_string_window);
+        unindex_window(frame->child_window);
+
+        for (i = 0; i < frame->button_list.count; i++)
+                unindex_window(frame->button_list.buttons[i].window);
+}
+
+
+NoteWM_IndexEntry* lookup_window(Window window)
+{
+        unsigned long mask;
+        unsigned long i;
+
+        if (window == None || window_index.count == 0)
+                return NULL;
+
+        mask = window_index.capacity - 1;
+        i = hash_window(window) & mask;
+
+        while (window_index.entries[i].window != None) {
+                if (window_index.entries[i].window == window)
+                        return &window_index.entries[i];
+                i = (i + 1) & mask;
+        }
+        return NULL;
+}
+
+
+void free_window_index(void)
+{
+        free(window_index.entries);
+        window_index.entries = NULL;
+        window_index.count = 0;
+        window_index.capacity = 0;
+}
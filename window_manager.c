@@ -11,189 +11,287 @@
  */
 #include "notewm.h"
 
-int ignore_xerrors(Display *display, XErrorEvent *error);
+bool is_ignored_error(XErrorEvent* error);
 
 unsigned int global_total_bar_height;
+Atom global_atoms[ATOM_COUNT];
+
+/* what _NET_CLIENT_LIST was last set to */
+static Window* written_client_windows = NULL;
+static unsigned int num_written_client_windows = 0;
+static unsigned int written_capacity = 0;
+
+/* names of the atoms in global_atoms, in the same order as the enum in notewm.h */
+const char* atom_names[ATOM_COUNT] = {
+        "_NET_WM_WINDOW_TYPE",
+        "_NET_WM_WINDOW_TYPE_NORMAL",
+        "_NET_WM_WINDOW_TYPE_DOCK",
+        "_NET_WM_WINDOW_TYPE_TOOLBAR",
+        "_NET_WM_WINDOW_TYPE_UTILITY",
+        "_NET_WM_WINDOW_TYPE_MENU",
+        "_NET_WM_WINDOW_TYPE_DIALOG",
+        "_NET_WM_WINDOW_TYPE_DROPDOWN_MENU",
+        "_NET_WM_WINDOW_TYPE_POPUP_MENU",
+        "_NET_WM_WINDOW_TYPE_TOOLTIP",
+        "_NET_WM_WINDOW_TYPE_NOTIFICATION",
+        "_NET_WM_WINDOW_TYPE_COMBO",
+        "_NET_WM_WINDOW_TYPE_DND",
+        "_NET_WM_WINDOW_TYPE_DESKTOP",
+        "_NET_WM_STATE",
+        "_NET_WM_STATE_MODAL",
+        "_NET_WM_STATE_HIDDEN",
+        "_NET_WM_STATE_ABOVE",
+        "_NET_WM_STATE_FULLSCREEN",
+        "_NET_SUPPORTED",
+        "_NET_CLIENT_LIST",
+        "_NET_NUMBER_OF_DESKTOPS",
+        "_NET_CURRENT_DESKTOP",
+        "_NET_DESKTOP_NAMES",
+        "_NET_DESKTOP_VIEWPORT",
+        "_NET_WM_DESKTOP",
+        "_NET_WM_NAME",
+        "UTF8_STRING",
+        "_NET_CLOSE_WINDOW",
+        "WM_PROTOCOLS",
+        "WM_DELETE_WINDOW",
+        "_NOTEWM_STATE"
+};
+
+
+void init_atoms(Display* display)
+{
+        /* a single round trip for every atom instead of one per use */
+        XInternAtoms(display, (char**) atom_names, ATOM_COUNT, false, global_atoms);
+}
 
 
+/* writes _NET_CLIENT_LIST if it changed since it was last written. every
+ * write wakes up every pager and bar watching the root window, so this is
+ * only done once per batch of events */
 void update_net_client_list(Display* display, Window root)
 {
-        Atom net_client_list = XInternAtom(display, "_NET_CLIENT_LIST", false);
-        XChangeProperty(display, root, net_client_list, XA_WINDOW, 32, PropModeReplace, (unsigned char*)global_state.client_windows, global_state.num_client_windows);
+        unsigned int num = global_state.num_client_windows;
+        size_t size = num * sizeof(Window);
+
+        global_state.client_list_dirty = false;
+        if (num == num_written_client_windows && (num == 0 || memcmp(written_client_windows, global_state.client_windows, size) == 0))
+                return;
+
+        if (num > written_capacity) {
+                written_capacity = global_state.client_capacity;
+                written_client_windows = realloc(written_client_windows, written_capacity * sizeof(Window));
+        }
+        if (num > 0)
+                memcpy(written_client_windows, global_state.client_windows, size);
+        num_written_client_windows = num;
+
+        XChangeProperty(display, root, global_atoms[ATOM_NET_CLIENT_LIST], XA_WINDOW, 32, PropModeReplace, (unsigned char*)global_state.client_windows, num);
 }
 
 
-void add_client_window(Display* display, Window root, Window window)
+void add_client_window(NoteWM_Frame* frame)
 {
-        int num = global_state.num_client_windows;
-        global_state.client_windows = realloc(global_state.client_windows, (num + 1) * sizeof(Window));
-        global_state.client_windows[num] = window;
+        unsigned int num = global_state.num_client_windows;
+
+        if (num == global_state.client_capacity) {
+                global_state.client_capacity = num ? num * 2 : 16;
+                global_state.client_windows = realloc(global_state.client_windows, global_state.client_capacity * sizeof(Window));
+                global_state.client_frames = realloc(global_state.client_frames, global_state.client_capacity * sizeof(NoteWM_Frame*));
+        }
+
+        global_state.client_windows[num] = frame->child_window;
+        global_state.client_frames[num] = frame;
+        frame->client_index = num;
         global_state.num_client_windows++;
-        update_net_client_list(display, root);
+        global_state.client_list_dirty = true;
 }
 
 
-void remove_client_window(Display* display, Window root, Window window)
+/* removes the frame's client by moving the last one into its place */
+void remove_client_window(NoteWM_Frame* frame)
 {
-        unsigned int i;
-        for (i = 0; i < global_state.num_client_windows; i++) {
-                if (global_state.client_windows[i] == window) {
-                        memmove(&global_state.client_windows[i], &global_state.client_windows[i + 1], (global_state.num_client_windows - i - 1) * sizeof(Window));
+        unsigned int i = frame->client_index;
+        unsigned int last = global_state.num_client_windows - 1;
 
-                        global_state.num_client_windows--;
+        if (i > last || global_state.client_frames[i] != frame)
+                return;
 
-                        global_state.client_windows = realloc(global_state.client_windows, global_state.num_client_windows * sizeof(Window));
+        global_state.client_windows[i] = global_state.client_windows[last];
+        global_state.client_frames[i] = global_state.client_frames[last];
+        global_state.client_frames[i]->client_index = i;
+        global_state.num_client_windows--;
+        global_state.client_list_dirty = true;
+}
 
-                        update_net_client_list(display, root);
 
-                        return;
-                }
-        }
+void free_client_window_list(void)
+{
+        free(global_state.client_windows);
+        free(global_state.client_frames);
+        free(written_client_windows);
+        global_state.client_windows = NULL;
+        global_state.client_frames = NULL;
+        written_client_windows = NULL;
+        global_state.num_client_windows = 0;
+        global_state.client_capacity = 0;
+        num_written_client_windows = 0;
+        written_capacity = 0;
 }
 
 
-void free_client_window_list(void)
+/* called once after every batch of events, right before the output buffer is flushed */
+void run_deferred_work(Display* display, Window root)
 {
-        if(global_state.client_windows) {
-                free(global_state.client_windows);
-                global_state.client_windows = NULL;
+        if (global_state.revert_focus) {
+                XSetInputFocus(display, root, RevertToPointerRoot, CurrentTime);
+                global_state.revert_focus = false;
         }
-        global_state.num_client_windows = 0;
+
+        if (global_state.client_list_dirty)
+                update_net_client_list(display, root);
+
+        flush_title_updates();
+        paint_dirty_frames(display);
 }
 
 
 void set_ewhm_desktop_properties(Display* display, Window root)
 {
-        Atom net_number_of_desktops = XInternAtom(display, "_NET_NUMBER_OF_DESKTOPS", false);
-        Atom net_current_desktop = XInternAtom(display, "_NET_CURRENT_DESKTOP", false);
-        Atom net_desktop_names = XInternAtom(display, "_NET_DESKTOP_NAMES", false);
-        Atom net_desktop_viewport = XInternAtom(display, "_NET_DESKTOP_VIEWPORT", false);
         XTextProperty text_property;
         long number_of_desktops = NUM_WORKSPACES;
         long current_desktop = global_state.current_workspace;
         const char* desktop_names[NUM_WORKSPACES] = {"1", "2", "3", "4", "5", "6", "7", "8", "9"};
         long desktop_viewport[NUM_WORKSPACES * 2] = {0};
 
-        XChangeProperty(display, root, net_number_of_desktops, XA_CARDINAL, 32, PropModeReplace, (unsigned char*)&number_of_desktops, 1);
-        XChangeProperty(display, root, net_current_desktop, XA_CARDINAL, 32, PropModeReplace, (unsigned char*)&current_desktop, 1);
+        XChangeProperty(display, root, global_atoms[ATOM_NET_NUMBER_OF_DESKTOPS], XA_CARDINAL, 32, PropModeReplace, (unsigned char*)&number_of_desktops, 1);
+        XChangeProperty(display, root, global_atoms[ATOM_NET_CURRENT_DESKTOP], XA_CARDINAL, 32, PropModeReplace, (unsigned char*)&current_desktop, 1);
 
         XStringListToTextProperty((char**) desktop_names, NUM_WORKSPACES, &text_property);
-        XSetTextProperty(display, root, &text_property, net_desktop_names);
+        XSetTextProperty(display, root, &text_property, global_atoms[ATOM_NET_DESKTOP_NAMES]);
         XFree(text_property.value);
 
-        XChangeProperty(display, root, net_desktop_viewport, XA_CARDINAL, 32, PropModeReplace, (unsigned char*)desktop_viewport, NUM_WORKSPACES * 2);
+        XChangeProperty(display, root, global_atoms[ATOM_NET_DESKTOP_VIEWPORT], XA_CARDINAL, 32, PropModeReplace, (unsigned char*)desktop_viewport, NUM_WORKSPACES * 2);
 }
 
 
 void set_net_wm_desktop(Display* display, Window window, int workspace_id)
 {
-        Atom net_wm_desktop = XInternAtom(display, "_NET_WM_DESKTOP", false);
-        XChangeProperty(display, window, net_wm_desktop, XA_CARDINAL, 32, PropModeReplace, (unsigned char*)&workspace_id, 1);
+        /* format 32 properties are passed to Xlib as arrays of long */
+        long desktop = workspace_id;
+        XChangeProperty(display, window, global_atoms[ATOM_NET_WM_DESKTOP], XA_CARDINAL, 32, PropModeReplace, (unsigned char*)&desktop, 1);
 }
 
 
 void set_net_supported(Display* display, Window root)
 {
-        Atom net_supported = XInternAtom(display, "_NET_SUPPORTED", false);
         Atom supported_atoms[6];
-        supported_atoms[0] = XInternAtom(display, "_NET_NUMBER_OF_DESKTOPS", false);
-        supported_atoms[1] = XInternAtom(display, "_NET_CURRENT_DESKTOP", false);
-        supported_atoms[2] = XInternAtom(display, "_NET_DESKTOP_NAMES", false);
-        supported_atoms[3] = XInternAtom(display, "_NET_DESKTOP_VIEWPORT", false);
-        supported_atoms[4] = XInternAtom(display, "_NET_WM_DESKTOP", false);
-        supported_atoms[5] = XInternAtom(display, "_NET_CLIENT_LIST", False);
-        XChangeProperty(display, root, net_supported, XA_ATOM, 32, PropModeReplace, (unsigned char*)&supported_atoms, sizeof(supported_atoms) / sizeof(supported_atoms[0]));
+        supported_atoms[0] = global_atoms[ATOM_NET_NUMBER_OF_DESKTOPS];
+        supported_atoms[1] = global_atoms[ATOM_NET_CURRENT_DESKTOP];
+        supported_atoms[2] = global_atoms[ATOM_NET_DESKTOP_NAMES];
+        supported_atoms[3] = global_atoms[ATOM_NET_DESKTOP_VIEWPORT];
+        supported_atoms[4] = global_atoms[ATOM_NET_WM_DESKTOP];
+        supported_atoms[5] = global_atoms[ATOM_NET_CLIENT_LIST];
+        XChangeProperty(display, root, global_atoms[ATOM_NET_SUPPORTED], XA_ATOM, 32, PropModeReplace, (unsigned char*)&supported_atoms, sizeof(supported_atoms) / sizeof(supported_atoms[0]));
 }
 
 
-void switch_to_workspace(Display* display, Window root, unsigned short new_workspace, NoteWM_Frame* list)
+void switch_to_workspace(Display* display, Window root, unsigned short new_workspace)
 {
-        NoteWM_Frame* frame = list;
-        Atom net_current_desktop = XInternAtom(display, "_NET_CURRENT_DESKTOP", false);
-        XChangeProperty(display, root, net_current_desktop, XA_CARDINAL, 32, PropModeReplace, (unsigned char*)&new_workspace, 1);
-        while (frame) {
-                if (frame->workspace_id == new_workspace
-                && is_valid_window(display, frame->child_window))
-                        XMapWindow(display, frame->frame);
-                else
-                        XUnmapWindow(display, frame->frame);
-                frame = frame->next;
+        NoteWM_Frame* frame;
+        long current_desktop = new_workspace;
+
+        if (new_workspace >= NUM_WORKSPACES || new_workspace == global_state.current_workspace)
+                return;
+
+        XChangeProperty(display, root, global_atoms[ATOM_NET_CURRENT_DESKTOP], XA_CARDINAL, 32, PropModeReplace, (unsigned char*)&current_desktop, 1);
+
+        /* only the two workspaces involved are touched. the new windows are
+         * mapped before the old ones are unmapped, under a grab so the root
+         * window never shows through in between */
+        XGrabServer(display);
+        for (frame = global_state.workspaces[new_workspace]; frame; frame = frame->ws_next) {
+                if (frame->child_mapped)
+                        map_frame(display, frame);
         }
+        for (frame = global_state.workspaces[global_state.current_workspace]; frame; frame = frame->ws_next)
+                unmap_frame(display, frame);
+        XUngrabServer(display);
+        ignore_crossing_events(display);
+
         global_state.current_workspace = new_workspace;
 }
 
 
-void focus_window(Display* display, Window window, NoteWM_Frame* list)
+void focus_window(Display* display, Window window)
 {
-        NoteWM_Frame* frame = find_frame_by_component(window, list);
+        NoteWM_Frame* frame = find_frame_by_component(window, NULL);
 
         if (frame) {
                 /*XRaiseWindow(display, frame->frame);*/
+                ignore_errors_begin(display);
                 XSetInputFocus(display, frame->child_window, RevertToPointerRoot, CurrentTime);
+                ignore_errors_end(display);
         }
 }
 
 
-void map_window(Display* display, Window root, Window window, NoteWM_Frame** list)
+/* marks every crossing event generated by the requests sent so far as our own.
+ * the no-op gives later pointer movement a newer serial, so events the user
+ * causes afterwards are never mistaken for ours */
+void ignore_crossing_events(Display* display)
 {
-        Atom type = XInternAtom(display, "_NET_WM_WINDOW_TYPE", false);
-        Atom actual_type;
-        XWindowAttributes attrs;
-        NoteWM_Frame* frame;
-        Window* children;
-        Window parent;
-        int actual_format;
-        unsigned long i;
-        unsigned long n_items;
-        unsigned int n_children;
-        unsigned long bytes_after;
-        unsigned char* data = NULL;
+        global_state.ignore_crossing_serial = NextRequest(display) - 1;
+        XNoOp(display);
+}
 
-        XGetWindowAttributes(display, window, &attrs);
 
-        if (attrs.override_redirect || attrs.map_state == IsViewable)
+void map_window(Display* display, Window root, Window window, NoteWM_Frame** list)
+{
+        NoteWM_ClientQuery query;
+        NoteWM_ClientInfo info;
+        bool prefetched;
+
+        /* ask for everything up front so this costs one round trip,
+         * unless it was already asked for when the window was created */
+        prefetched = take_pending_client(window, &query);
+        if (!prefetched)
+                query_client_info(display, window, &query);
+        if (!collect_client_info(display, &query, &info))
                 return;
 
-        if (XQueryTree(display, window, &root, &parent, &children, &n_children)) {
-                if (children)
-                        XFree(children);
-                /* do not frame windows that are children of other windows
-                 * (besides the root window) */
-                if (parent != root) {
-                        map_noframe_window(display, window);
-                        return;
+        if (info.override_redirect || info.map_state == IsViewable) {
+                /* undo the PropertyChangeMask the prefetch selected */
+                if (prefetched) {
+                        ignore_errors_begin(display);
+                        XSelectInput(display, window, NoEventMask);
+                        ignore_errors_end(display);
                 }
+                return;
         }
 
-        /* get _NET_WM_TYPE atoms */
-        XGetWindowProperty(
-                display, window, type, 0, (~0L), False, AnyPropertyType,
-                &actual_type, &actual_format, &n_items, &bytes_after, &data
-        );
+        manage_client(display, root, &info, list);
+}
 
-        printf("Mapping window %ld\n", window);
-
-        if (data != NULL) {
-                for (i = 0; i < n_items; i++) {
-                        Atom atom = ((Atom *)data)[i];
-
-                        if (atom == _NET_WM_WINDOW_TYPE_NORMAL
-                        || atom == _NET_WM_WINDOW_TYPE_DIALOG) {
-
-                                frame = create_frame(display, window, root);
-                                add_frame(frame, list);
-                                XFree(data);
-                                return;
-                        }
-                        else {
-                                map_noframe_window(display, window);
-                                XFree(data);
-                                return;
-                        }
-                }
-                XFree(data);
+
+/* frames the client described by info, or just maps it if it should not have a frame */
+void manage_client(Display* display, Window root, NoteWM_ClientInfo* info, NoteWM_Frame** list)
+{
+        NoteWM_Frame* frame;
+
+        /* do not frame windows that are children of other windows
+         * (besides the root window) */
+        if (info->parent != root) {
+                map_noframe_window(display, info);
+                return;
+        }
+
+        printf("Mapping window %ld\n", info->window);
+
+        if (!is_framed_window_type(info)) {
+                map_noframe_window(display, info);
+                return;
         }
-        frame = create_frame(display, window, root);
+        frame = create_frame(display, info, root);
         add_frame(frame, list);
 }
 
@@ -206,37 +304,25 @@ void get_display_dimensions(Display* display, int* width, int* height)
 }
 
 
-void update_window_type(Display* display, Window window)
+unsigned long get_time_ms(void)
 {
-        Atom state = get_atom(display, window, "_NET_WM_STATE");
-        Atom window_type = get_atom(display, window, "_NET_WM_WINDOW_TYPE");
-
-        if (state == _NET_WM_STATE_FULLSCREEN)
-                printf("window wants to be fullscreen\n");
-        if (window_type == _NET_WM_WINDOW_TYPE_DIALOG)
-                printf("window wants to be dialog\n");
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (unsigned long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
 
-Atom get_atom(Display* display, Window window, const char* atom_name)
+void update_window_type(Display* display, NoteWM_Frame* frame)
 {
-        Atom atom = XInternAtom(display, atom_name, true);
-        Atom prop = None;
-        Atom dummy_atom = None;
-        int dummy_i;
-        unsigned long dummy_l;
-        unsigned char* data;
-        if (XGetWindowProperty(display, window, atom, 0L, sizeof prop, false, XA_ATOM,
-                &dummy_atom, &dummy_i, &dummy_l, &dummy_l, &data) == Success && data) {
-
-                prop = *(Atom *)data;
-                XFree(data);
-        }
-
-        return prop;
+        refresh_frame_info(display, frame);
 
+        if (client_has_state(&frame->info, global_atoms[ATOM_NET_WM_STATE_FULLSCREEN]))
+                printf("window wants to be fullscreen\n");
+        if (client_window_type(&frame->info) == global_atoms[ATOM_NET_WM_WINDOW_TYPE_DIALOG])
+                printf("window wants to be dialog\n");
 }
 
+
 void grab_change_cursor(Display* display, Window window, Cursor cursor)
 {
         XGrabPointer(
@@ -253,40 +339,56 @@ void grab_change_cursor(Display* display, Window window, Cursor cursor)
 }
 
 
+/* manages the windows that were already mapped when NoteWM started. the
+ * server is grabbed so that nothing changes while the windows are read, and
+ * the queries for all of them are sent before any reply is waited for */
 void adopt_existing_windows(Display* display, Window root, NoteWM_Frame** list)
 {
+        NoteWM_ClientQuery* queries;
+        NoteWM_ClientInfo info;
         Window returned_root;
         Window returned_parent;
         Window* children;
-        unsigned int i;
         unsigned int num_children;
+        unsigned int adopted = 0;
+        unsigned int i;
+        unsigned long start = get_time_ms();
+
+        XGrabServer(display);
+
+        if (!XQueryTree(display, root, &returned_root, &returned_parent, &children, &num_children) || !children) {
+                XUngrabServer(display);
+                return;
+        }
 
-        XQueryTree(display, root, &returned_root, &returned_parent, &children, &num_children);
+        queries = malloc(num_children * sizeof(NoteWM_ClientQuery));
         for (i = 0; i < num_children; i++) {
-                XWindowAttributes attrs;
-                XGetWindowAttributes(display, children[i], &attrs);
-                if (attrs.map_state == IsViewable) {
-                        map_window(display, root, children[i], list);
+                /* clients framed again after a restart are already managed */
+                if (lookup_window(children[i])) {
+                        queries[i].window = None;
+                        continue;
                 }
+                query_client_info(display, children[i], &queries[i]);
         }
-        XFree(children);
-}
 
-
-void launch_program(const char* program)
-{
-        pid_t pid = fork();
-
-        if (pid == 0) {
-                char* argv[] = {NULL, NULL};
-                argv[0] = (char*) program;
-                execvp(argv[0], argv);
-                perror("execvp");
-                exit(1);
-        }
-        else if (pid < 0) {
-                perror("fork");
+        for (i = 0; i < num_children; i++) {
+                if (queries[i].window == None)
+                        continue;
+                if (!collect_client_info(display, &queries[i], &info))
+                        continue;
+                if (info.override_redirect || info.map_state != IsViewable)
+                        continue;
+
+                manage_client(display, root, &info, list);
+                adopted++;
         }
+
+        XUngrabServer(display);
+        XFlush(display);
+
+        free(queries);
+        XFree(children);
+        printf("adopted %u of %u windows in %lu ms\n", adopted, num_children, get_time_ms() - start);
 }
 
 
@@ -315,7 +417,7 @@ void grab_buttons(Display* display, Window root, NoteWM_MouseBinding* mousebindi
                 unsigned int modifiers = mousebindings[i].modifiers;
                 XGrabButton(
                         display, button, modifiers, root, True,
-                        ButtonPressMask | ButtonReleaseMask | PointerMotionMask,
+                        ButtonPressMask | ButtonReleaseMask,
                         GrabModeAsync, GrabModeAsync,
                         None, None
                 );
@@ -324,68 +426,19 @@ void grab_buttons(Display* display, Window root, NoteWM_MouseBinding* mousebindi
 }
 
 
-/* this function is a modified version of gettextprop from dwm */
-int get_window_name(Display* display, Window window, char* text, unsigned int size)
-{
-        XTextProperty name;
-        Atom net_wm_name = XInternAtom(display, "_NET_WM_NAME", false);
-        char** list = NULL;
-        int n;
-
-        if (!text || size == 0) {
-                return 0;
-        }
-
-        text[0] = '\0';
-
-        if ((!XGetTextProperty(display, window, &name, net_wm_name) || !name.nitems)
-        && (!XGetTextProperty(display, window, &name, XA_WM_NAME) || !name.nitems)) {
-                return 0;
-        }
-
-        if (name.encoding == XA_STRING) {
-                strncpy(text, (char*)name.value, size - 1);
-        }
-        else if (XmbTextPropertyToTextList(display, &name, &list, &n) >= Success && n > 0 && *list) {
-                strncpy(text, *list, size - 1);
-                XFreeStringList(list);
-        }
-
-        text[size - 1] = '\0';
-        XFree(name.value);
-
-        return 1;
-}
-
-
-void close_frame(Display* display, Window root, NoteWM_Frame* frame, NoteWM_Frame** list)
+void close_frame(Display* display, NoteWM_Frame* frame, NoteWM_Frame** list)
 {
-        Atom wm_protocols = XInternAtom(display, "WM_PROTOCOLS", false);
-        Atom wm_delete_window = XInternAtom(display, "WM_DELETE_WINDOW", false);
-        Atom* protocols = NULL;
-        int num_protocols;
-        int i;
-        bool supports_del_window = false;
-
-        if (!XGetWMProtocols(display, frame->child_window, &protocols, &num_protocols)) {
-                num_protocols = 0;
-        }
+        Atom wm_delete_window = global_atoms[ATOM_WM_DELETE_WINDOW];
 
-        for (i = 0; i < num_protocols; i++) {
-                if (protocols[i] == wm_delete_window) {
-                        supports_del_window = true;
-                        break;
-                }
-        }
+        /* WM_PROTOCOLS is only asked for again if it changed since we last read it */
+        refresh_frame_info(display, frame);
 
-        XFree(protocols);
-
-        if (supports_del_window) {
+        if (frame->info.supports_delete_window) {
                 /* client supports WM_DELETE_WINDOW so we send a delete window event to it */
                 XEvent event;
                 event.xclient.type = ClientMessage;
                 event.xclient.window = frame->child_window;
-                event.xclient.message_type = wm_protocols;
+                event.xclient.message_type = global_atoms[ATOM_WM_PROTOCOLS];
                 event.xclient.format = 32;
                 event.xclient.data.l[0] = wm_delete_window;
                 event.xclient.data.l[1] = CurrentTime;
@@ -394,63 +447,91 @@ void close_frame(Display* display, Window root, NoteWM_Frame* frame, NoteWM_Fram
         }
         else {
                 /* otherwise forcefully kill the window */
-                XDestroyWindow(display, frame->frame);
-                remove_client_window(display, root, frame->child_window);
+                remove_client_window(frame);
                 remove_frame(display, frame, list);
         }
 }
 
 
-void map_noframe_window(Display* display, Window window)
+void map_noframe_window(Display* display, NoteWM_ClientInfo* info)
 {
-        XWindowAttributes attrs;
-        XSizeHints hints;
-        long msize;
-        int width = 1;
-        int height = 1;
-
-        XGetWindowAttributes(display, window, &attrs);
-
-        if (XGetWMNormalHints(display, window, &hints, &msize) && (hints.flags & PSize) && hints.width != 0) {
-                width = hints.width;
-                height = hints.height;
-        } else if (attrs.width != 0 && attrs.height != 0) {
-                width = attrs.width;
-                height = attrs.height;
-        }
-        else {
-                XResizeWindow(display, window, width, height);
-        }
+        if (!info->has_size_hint && (info->width == 0 || info->height == 0))
+                XResizeWindow(display, info->window, 1, 1);
 
-        XSelectInput(display, window, StructureNotifyMask | SubstructureRedirectMask);
-        XMapWindow(display, window);
+        XSelectInput(display, info->window, StructureNotifyMask | SubstructureRedirectMask);
+        XMapWindow(display, info->window);
 }
 
 
-int xerror_handler(Display* display, XErrorEvent* error)
+/* ranges of request serials whose errors are expected, e.g. requests on a
+ * client window that may have been destroyed before we saw its DestroyNotify */
+#define MAX_IGNORED_RANGES 32
+
+static struct {
+        unsigned long start;
+        unsigned long end;
+} ignored_ranges[MAX_IGNORED_RANGES];
+static unsigned int num_ignored_ranges = 0;
+static unsigned long ignore_start_serial = 0;
+
+
+void ignore_errors_begin(Display* display)
 {
-        char error_msg[120];
-        XGetErrorText(display, error->error_code, error_msg, sizeof(error_msg));
-        fprintf(stderr, "X Error: %s\n", error_msg);
-        /*exit(1);*/
-        return 0;
+        ignore_start_serial = NextRequest(display);
 }
 
 
-int ignore_xerrors(Display* display, XErrorEvent* error)
+void ignore_errors_end(Display* display)
 {
-        (void) display; (void) error;
-        return 0;
+        unsigned long last_processed = LastKnownRequestProcessed(display);
+        unsigned int i = 0;
+
+        if (NextRequest(display) == ignore_start_serial)
+                return;
+
+        /* errors are read in request order, so ranges that end before the last
+         * request the server has processed can no longer produce errors */
+        while (i < num_ignored_ranges) {
+                if (ignored_ranges[i].end < last_processed)
+                        ignored_ranges[i] = ignored_ranges[--num_ignored_ranges];
+                else
+                        i++;
+        }
+
+        ignored_ranges[num_ignored_ranges].start = ignore_start_serial;
+        ignored_ranges[num_ignored_ranges].end = NextRequest(display) - 1;
+        num_ignored_ranges++;
+
+        if (num_ignored_ranges == MAX_IGNORED_RANGES) {
+                /* full, so wait for every range to be answered. this range is
+                 * registered first so its errors are still ignored by the sync */
+                XSync(display, false);
+                num_ignored_ranges = 0;
+        }
+}
+
+
+bool is_ignored_error(XErrorEvent* error)
+{
+        unsigned int i;
+        for (i = 0; i < num_ignored_ranges; i++) {
+                if (error->serial >= ignored_ranges[i].start
+                && error->serial <= ignored_ranges[i].end)
+                        return true;
+        }
+        return false;
 }
 
 
-bool is_valid_window(Display* display, Window window)
+int xerror_handler(Display* display, XErrorEvent* error)
 {
-        XWindowAttributes attrs;
-        int result;
-        XSetErrorHandler(ignore_xerrors);
-        result = XGetWindowAttributes(display, window, &attrs);
-        XSync(display, false);
-        XSetErrorHandler(xerror_handler);
-        return (result != 0);
+        char error_msg[120];
+
+        if (is_ignored_error(error))
+                return 0;
+
+        XGetErrorText(display, error->error_code, error_msg, sizeof(error_msg));
+        fprintf(stderr, "X Error: %s\n", error_msg);
+        /*exit(1);*/
+        return 0;
 }